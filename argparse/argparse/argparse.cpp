@@ -20,380 +20,3579 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 #include "argparse.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
 #include <iostream>
-#include <iomanip>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARGPARSE_SSE2
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#undef NO_ERROR	// winerror.h, clashes with ArgErrorCode
+#else
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace argparse {
 
-	void ArgumentParser::_init()
+	// Nesting limit for response files, also stops "@a" -> "@a" cycles
+	static const int max_response_file_depth = 16;
+
+	// Character classes used by the tokenizer, one table lookup per character
+	enum CharClass : unsigned char {
+		cName = 1,	// allowed in an option name (between single '-' separators)
+		cDigit = 2,
+		cDash = 4,
+		cQuote = 8,
+		cBlank = 16,	// separates shell words
+		cShell = 32		// ends a plain run of a shell word: blanks, quotes, backslash
+	};
+
+	struct CharTable {
+		unsigned char classes[256];
+		constexpr CharTable(): classes() {
+			for (int c = 0; c < 256; ++c) {
+				unsigned char cls = 0;
+				if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
+					cls |= cName;
+				if (c >= '0' && c <= '9')
+					cls |= cDigit;
+				if (c == '-')
+					cls |= cDash;
+				if (c == '\'')
+					cls |= cQuote;
+				if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+					cls |= cBlank | cShell;
+				if (c == '\'' || c == '"' || c == '\\')
+					cls |= cShell;
+				this->classes[c] = cls;
+			}
+		}
+	};
+
+	static constexpr CharTable char_table;
+
+	static inline bool has_class(char c, unsigned char cls)
+	{
+		return (char_table.classes[static_cast<unsigned char>(c)] & cls) != 0;
+	}
+
+	static inline bool is_name_char(char c)
+	{
+		return has_class(c, cName);
+	}
+
+	static inline bool is_digit(char c)
+	{
+		return has_class(c, cDigit);
+	}
+
+	template <typename T>
+	static ArgErrorCode convert_integer(std::string_view str, T & target)
+	{
+		const char * first = str.data();
+		const char * last = first + str.size();
+		bool negative = false;
+		if (first != last && (*first == '+' || *first == '-')) {
+			negative = *first == '-';
+			++first;
+		}
+		// only an explicit prefix changes the base, "010" is ten
+		int base = 10;
+		if (last - first > 2 && first[0] == '0') {
+			switch (first[1]) {
+			case 'x': case 'X': base = 16; break;
+			case 'b': case 'B': base = 2; break;
+			case 'o': case 'O': base = 8; break;
+			}
+			if (base != 10)
+				first += 2;
+		}
+		// from_chars would take a second sign for signed types
+		if (first == last || *first == '+' || *first == '-')
+			return CONVERT_ARG_ERROR;
+		std::uint64_t magnitude;
+		auto res = std::from_chars(first, last, magnitude, base);
+		if (res.ec == std::errc::result_out_of_range)
+			return CONVERT_ARG_RANGE_ERROR;
+		if (res.ec != std::errc() || res.ptr != last)
+			return CONVERT_ARG_ERROR;
+		using U = typename std::make_unsigned<T>::type;
+		U limit = static_cast<U>(std::numeric_limits<T>::max());
+		if (std::is_signed<T>::value && negative)
+			++limit;
+		else if (negative && magnitude != 0)
+			return CONVERT_ARG_RANGE_ERROR;
+		if (magnitude > limit)
+			return CONVERT_ARG_RANGE_ERROR;
+		target = static_cast<T>(negative ? U(0) - static_cast<U>(magnitude) : static_cast<U>(magnitude));
+		return NO_ERROR;
+	}
+
+	template <typename T>
+	static ArgErrorCode convert_floating(std::string_view str, T & target)
+	{
+		const char * first = str.data();
+		const char * last = first + str.size();
+		// from_chars takes '-' but not '+'
+		if (first != last && *first == '+') {
+			++first;
+			if (first != last && *first == '-')
+				return CONVERT_ARG_ERROR;
+		}
+		if (first == last)
+			return CONVERT_ARG_ERROR;
+#if defined(__cpp_lib_to_chars)
+		auto res = std::from_chars(first, last, target);
+		if (res.ec == std::errc::result_out_of_range)
+			return CONVERT_ARG_RANGE_ERROR;
+		if (res.ec != std::errc() || res.ptr != last)
+			return CONVERT_ARG_ERROR;
+		return NO_ERROR;
+#else
+		// Standard library without floating point from_chars: strtod on a stack copy
+		char buffer[128];
+		size_t length = static_cast<size_t>(last - first);
+		if (length >= sizeof(buffer) || !(is_digit(*first) || *first == '.' || *first == '-'))
+			return CONVERT_ARG_ERROR;
+		std::memcpy(buffer, first, length);
+		buffer[length] = '\0';
+		char * end = nullptr;
+		errno = 0;
+		double value = std::strtod(buffer, &end);
+		if (end != buffer + length)
+			return CONVERT_ARG_ERROR;
+		if (errno == ERANGE || std::fabs(value) > std::numeric_limits<T>::max())
+			return CONVERT_ARG_RANGE_ERROR;
+		target = static_cast<T>(value);
+		return NO_ERROR;
+#endif
+	}
+
+	ArgErrorCode convert_arg(std::string_view str, int & target)
+	{
+		return convert_integer(str, target);
+	}
+
+	ArgErrorCode convert_arg(std::string_view str, std::int64_t & target)
+	{
+		return convert_integer(str, target);
+	}
+
+	ArgErrorCode convert_arg(std::string_view str, std::uint64_t & target)
+	{
+		return convert_integer(str, target);
+	}
+
+	ArgErrorCode convert_arg(std::string_view str, float & target)
+	{
+		return convert_floating(str, target);
+	}
+
+	ArgErrorCode convert_arg(std::string_view str, double & target)
+	{
+		return convert_floating(str, target);
+	}
+
+	static inline bool is_little_endian()
+	{
+		const std::uint16_t probe = 1;
+		unsigned char first;
+		std::memcpy(&first, &probe, 1);
+		return first == 1;
+	}
+
+	// SWAR digit parsing: eight ASCII digits in one 64-bit word, first digit in the
+	// lowest byte (little endian only)
+	static inline bool swar_is_digits(std::uint64_t chunk)
+	{
+		return (((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+	}
+
+	static inline std::uint32_t swar_parse8(std::uint64_t chunk)
+	{
+		chunk -= 0x3030303030303030ull;
+		chunk = (chunk * 10) + (chunk >> 8);	// pairs
+		chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+			+ (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+		return static_cast<std::uint32_t>(chunk);
+	}
+
+	// Up to 19 decimal digits -> value, false if any is not a digit. Leading
+	// digits one at a time, then eight per step.
+	static inline bool parse_digits(const char * p, size_t n, std::uint64_t & value)
+	{
+		std::uint64_t result = 0;
+		size_t i = 0;
+		for (; (n - i) % 8 != 0; ++i) {
+			unsigned int digit = static_cast<unsigned char>(p[i]) - '0';
+			if (digit > 9)
+				return false;
+			result = result * 10 + digit;
+		}
+		for (; i < n; i += 8) {
+			std::uint64_t chunk;
+			std::memcpy(&chunk, p + i, 8);
+			if (!swar_is_digits(chunk))
+				return false;
+			result = result * 100000000ull + swar_parse8(chunk);
+		}
+		value = result;
+		return true;
+	}
+
+	// Fast path for "[-]digits" without leading zero. false sends the token to
+	// convert_arg(), which also produces the error code.
+	template <typename T>
+	static inline bool convert_integer_fast(std::string_view str, T & target)
+	{
+		const char * p = str.data();
+		size_t n = str.size();
+		bool negative = n != 0 && *p == '-';
+		if (negative) {
+			++p;
+			--n;
+		}
+		if (n == 0 || n > 19 || (n > 1 && *p == '0'))
+			return false;
+		std::uint64_t magnitude;
+		if (!parse_digits(p, n, magnitude))
+			return false;
+		using U = typename std::make_unsigned<T>::type;
+		U limit = static_cast<U>(std::numeric_limits<T>::max());
+		if (std::is_signed<T>::value && negative)
+			++limit;
+		else if (negative)
+			return false;
+		if (magnitude > limit)
+			return false;
+		target = static_cast<T>(negative ? U(0) - static_cast<U>(magnitude) : static_cast<U>(magnitude));
+		return true;
+	}
+
+	// Fast path for "[-]digits[.digits]" with at most 15 digits: the
+	// mantissa and the power of ten are exact, so one division rounds correctly.
+	template <typename T>
+	static inline bool convert_floating_fast(std::string_view str, T & target)
+	{
+		static const double powers_of_ten[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+		};
+		const char * p = str.data();
+		size_t n = str.size();
+		bool negative = n != 0 && *p == '-';
+		if (negative) {
+			++p;
+			--n;
+		}
+		if (n == 0 || n > 16)
+			return false;
+		// digits and at most one '.', accumulated in one pass
+		std::uint64_t mantissa = 0;
+		size_t digits = 0, frac_digits = 0;
+		bool dot = false;
+		for (size_t i = 0; i < n; ++i) {
+			unsigned int digit = static_cast<unsigned char>(p[i]) - '0';
+			if (digit < 10) {
+				mantissa = mantissa * 10 + digit;
+				++digits;
+				frac_digits += dot;
+			} else if (p[i] == '.' && !dot) {
+				dot = true;
+			} else {
+				return false;
+			}
+		}
+		if (digits == 0 || digits > 15)
+			return false;
+		if (std::is_same<T, float>::value) {
+			// same argument in float: mantissa < 2^24 and 10^10 are exact
+			if (mantissa >= (1u << 24) || frac_digits > 10)
+				return false;
+			float value = static_cast<float>(mantissa) / static_cast<float>(powers_of_ten[frac_digits]);
+			target = static_cast<T>(negative ? -value : value);
+			return true;
+		}
+		double value = static_cast<double>(mantissa) / powers_of_ten[frac_digits];
+		target = static_cast<T>(negative ? -value : value);
+		return true;
+	}
+
+	template <typename T>
+	static ArgErrorCode convert_bulk(const std::string_view * tokens, size_t count, T * target, size_t & failed)
+	{
+		const bool swar = is_little_endian();
+		for (size_t i = 0; i < count; ++i) {
+			if (swar) {
+				bool done;
+				if constexpr (std::is_integral<T>::value)
+					done = convert_integer_fast(tokens[i], target[i]);
+				else
+					done = convert_floating_fast(tokens[i], target[i]);
+				if (done)
+					continue;
+			}
+			ArgErrorCode code = convert_arg(tokens[i], target[i]);
+			if (code != NO_ERROR) {
+				failed = i;
+				return code;
+			}
+		}
+		return NO_ERROR;
+	}
+
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, int * target, size_t & failed)
+	{
+		return convert_bulk(tokens, count, target, failed);
+	}
+
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, std::int64_t * target, size_t & failed)
+	{
+		return convert_bulk(tokens, count, target, failed);
+	}
+
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, std::uint64_t * target, size_t & failed)
+	{
+		return convert_bulk(tokens, count, target, failed);
+	}
+
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, float * target, size_t & failed)
+	{
+		return convert_bulk(tokens, count, target, failed);
+	}
+
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, double * target, size_t & failed)
+	{
+		return convert_bulk(tokens, count, target, failed);
+	}
+
+	// Converts the tokens of a list argument into a new run at the end of list
+	template <typename T>
+	static ArgErrorCode convert_list(const std::pmr::vector<std::string_view> & tokens, ArgSlot & slot, std::pmr::vector<T> & list, size_t & failed)
+	{
+		size_t offset = list.size();
+		list.resize(offset + slot.list_size);
+		ArgErrorCode code = convert_args(tokens.data() + slot.list_offset, slot.list_size, list.data() + offset, failed);
+		if (code != NO_ERROR) {
+			// leave the slot pointing at its tokens, a later access fails the same way
+			list.resize(offset);
+			failed += slot.list_offset;
+			return code;
+		}
+		slot.list_offset = static_cast<unsigned int>(offset);
+		return code;
+	}
+
+	// Option-like token: ends a list of values
+	static inline bool is_option_token(std::string_view token)
+	{
+		return !token.empty() && has_class(token.front(), cDash) && !ArgumentParser::is_negative_number(token);
+	}
+
+	// Usage text for the values of arg, e.g. "IDS [IDS ...]"
+	// Appends how the values of arg are shown in help: "NAME", "[NAME]", "NAME [NAME ...]"...
+	static void append_metavar(std::pmr::string & out, const ArgConfig & arg, std::string_view name)
+	{
+		switch (arg.arg_nargs) {
+		case ArgNargs::nOne:
+			out.append(name.data(), name.size());
+			return;
+		case ArgNargs::nOptional:
+			out += '[';
+			out.append(name.data(), name.size());
+			out += ']';
+			return;
+		case ArgNargs::nZeroOrMore:
+			out += '[';
+			out.append(name.data(), name.size());
+			out += " ...]";
+			return;
+		case ArgNargs::nOneOrMore:
+			out.append(name.data(), name.size());
+			out += " [";
+			out.append(name.data(), name.size());
+			out += " ...]";
+			return;
+		case ArgNargs::nExactly:
+			break;
+		}
+		out.append(name.data(), name.size());
+		for (unsigned int i = 1; i < arg.nargs_min; ++i) {
+			out += ' ';
+			out.append(name.data(), name.size());
+		}
+	}
+
+	// Length of what append_metavar() appends for a name of name_size characters
+	static size_t metavar_size(const ArgConfig & arg, size_t name_size)
+	{
+		switch (arg.arg_nargs) {
+		case ArgNargs::nOne:
+			return name_size;
+		case ArgNargs::nOptional:
+			return name_size + 2;
+		case ArgNargs::nZeroOrMore:
+			return name_size + 6;
+		case ArgNargs::nOneOrMore:
+			return 2 * name_size + 7;
+		case ArgNargs::nExactly:
+			break;
+		}
+		size_t count = std::max(arg.nargs_min, 1u);
+		return count * name_size + count - 1;
+	}
+
+	void ArgumentParser::_init()
+	{
+		_max_arg_name_len = 0;
+		this->arguments_count = 0;
+		this->positional_count = 0;
+		this->optional_count = 0;
+		this->_positional_min = 0;
+		this->_positional_open = false;
+		#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+		os_sep = '\\';
+		#else
+		os_sep = '/';
+		#endif
+		exec_name += ".exe";
+		this->_response_format = ResponseFileFormat::fNone;
+		this->_response_prefix = '@';
+		this->_lazy_conversion = false;
+		this->_abbreviations = false;
+		this->_config_required = false;
+		this->_has_env = false;
+		this->_rule_width = 0;
+		this->_help_width = 0;
+		this->_help_valid = false;
+		this->_usage_size = 0;
+		this->_schema_valid = false;
+		this->_schema = 0;
+		std::fill(std::begin(this->_short_index), std::end(this->_short_index), static_cast<unsigned short>(0));
+	}
+
+#ifdef ARGPARSE_STATS
+	static inline std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+
+	// Adds the time until the end of the scope to a phase, or to the parse histogram
+	struct StatsTimer {
+		ParseStats * stats;
+		int phase;			// -1 for the whole parse
+		std::chrono::steady_clock::time_point start;
+
+		StatsTimer(ParseStats * stats, int phase):
+			stats(stats),
+			phase(phase)
+		{
+			if (stats)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~StatsTimer()
+		{
+			if (!stats)
+				return;
+			if (phase < 0)
+				stats->add_parse(elapsed_ns(start));
+			else
+				stats->phase_ns[phase] += elapsed_ns(start);
+		}
+	};
+
+	#define ARGPARSE_PARSE_TIMER(result) StatsTimer _parse_timer((result)._stats, -1)
+	#define ARGPARSE_PHASE(result, phase) StatsTimer _phase_timer((result)._stats, static_cast<int>(ParsePhase::phase))
+	#define ARGPARSE_COUNT(result, counter, n) do { if ((result)._stats) (result)._stats->counter += (n); } while (0)
+#else
+	#define ARGPARSE_PARSE_TIMER(result)
+	#define ARGPARSE_PHASE(result, phase)
+	#define ARGPARSE_COUNT(result, counter, n)
+#endif
+
+	// Parse state carried from token to token by the single-pass tokenizer
+	struct ArgumentParser::Tokenizer {
+		ParseResult & result;
+		int argv_index;				// argv entry the current token comes from
+		int pending;				// option waiting for its single value
+		int collecting;				// nargs option taking values up to the next option
+		size_t option_token;		// sanitized index of the pending / collecting option
+		size_t collect_first;
+		size_t collected;
+		size_t positional;			// index into _positionals of the positional being filled
+		size_t positional_first;
+		size_t positional_taken;
+		bool positional_paused;		// the trailing variable positional was interrupted by an option
+		ParseError positional_error;	// first one, dropped by DROP_POSITIONAL_CHECK / --help
+		ParseError error;			// stops the parse
+		void * object;				// config struct for member bindings, may be nullptr
+
+		explicit Tokenizer(ParseResult & result):
+			result(result),
+			argv_index(0),
+			pending(-1),
+			collecting(-1),
+			option_token(0),
+			collect_first(0),
+			collected(0),
+			positional(0),
+			positional_first(0),
+			positional_taken(0),
+			positional_paused(false),
+			object(nullptr)
+		{
+		}
+	};
+
+	// Subcommand: the parser is built from factory when the name is first matched
+	struct ArgumentParser::Subcommand {
+		std::string_view name;
+		std::string_view help;
+		std::function<void(ArgumentParser &)> factory;
+		std::once_flag built;
+		ArgumentParser * parser;	// in the parent's arena
+
+		Subcommand(std::string_view name, std::string_view help, std::function<void(ArgumentParser &)> factory):
+			name(name),
+			help(help),
+			factory(std::move(factory)),
+			parser(nullptr)
+		{
+		}
+
+		~Subcommand()
+		{
+			if (this->parser)
+				this->parser->~ArgumentParser();
+		}
+	};
+
+	// First blank, quote or backslash in [p, end), or end
+	static inline const char * find_shell_special(const char * p, const char * end)
+	{
+	#ifdef ARGPARSE_SSE2
+		// 16 bytes per step, one compare per special character
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i single_quote = _mm_set1_epi8('\'');
+		const __m128i double_quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		for (; end - p >= 16; p += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			__m128i hit = _mm_or_si128(
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+					_mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, cr))),
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, single_quote), _mm_cmpeq_epi8(block, double_quote)),
+					_mm_cmpeq_epi8(block, backslash)));
+			unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hit));
+			if (mask) {
+				while (!(mask & 1)) {
+					mask >>= 1;
+					++p;
+				}
+				return p;
+			}
+		}
+	#endif
+		while (p != end && !has_class(*p, cShell))
+			++p;
+		return p;
+	}
+
+	// Splits line into words like a POSIX shell, unquoted into buffer (never longer
+	// than line). Returns the offset of an unterminated quote, npos on success.
+	static size_t split_command_line(std::string_view line, std::pmr::vector<char> & buffer, std::pmr::vector<std::string_view> & words)
+	{
+		words.clear();
+		buffer.resize(line.size());
+		char * out = buffer.data();
+		const char * p = line.data();
+		const char * end = p + line.size();
+		// NUL-separated (/proc/<pid>/cmdline): no quoting. Every word ends at a NUL,
+		// the last one may end at the end of line instead, so a trailing NUL adds no
+		// word: "a\0b c\0" is [a] [b c]. "\0\0" is an empty word, as for tool ''.
+		if (std::memchr(p, '\0', line.size())) {
+			std::memcpy(out, p, line.size());
+			const char * word = out;
+			const char * stop = out + line.size();
+			while (word != stop) {
+				const char * nul = static_cast<const char *>(std::memchr(word, '\0', stop - word));
+				if (!nul)
+					nul = stop;
+				words.emplace_back(word, nul - word);
+				word = (nul == stop) ? stop : nul + 1;
+			}
+			return std::string_view::npos;
+		}
+		const char * word = nullptr;
+		while (p != end) {
+			const char * special = find_shell_special(p, end);
+			if (special != p) {
+				if (!word)
+					word = out;
+				std::memcpy(out, p, special - p);
+				out += special - p;
+				p = special;
+				if (p == end)
+					break;
+			}
+			char c = *p;
+			if (has_class(c, cBlank)) {
+				if (word) {
+					words.emplace_back(word, out - word);
+					word = nullptr;
+				}
+				++p;
+				continue;
+			}
+			// backslash-newline joins lines
+			if (c == '\\' && p + 1 != end && p[1] == '\n') {
+				p += 2;
+				continue;
+			}
+			if (!word)
+				word = out;
+			if (c == '\\') {
+				// escapes the next character, a trailing one is kept
+				if (p + 1 != end)
+					++p;
+				*out++ = *p++;
+			} else if (c == '\'') {
+				// literal up to the closing quote
+				const char * close = static_cast<const char *>(std::memchr(p + 1, '\'', end - p - 1));
+				if (!close)
+					return static_cast<size_t>(p - line.data());
+				std::memcpy(out, p + 1, close - p - 1);
+				out += close - p - 1;
+				p = close + 1;
+			} else {
+				// double quotes: backslash only escapes $ ` " \\ and newline
+				const char * open = p++;
+				for (;;) {
+					const char * q = p;
+					while (q != end && *q != '"' && *q != '\\')
+						++q;
+					std::memcpy(out, p, q - p);
+					out += q - p;
+					p = q;
+					if (p == end)
+						return static_cast<size_t>(open - line.data());
+					if (*p == '"') {
+						++p;
+						break;
+					}
+					if (p + 1 != end && (p[1] == '$' || p[1] == '`' || p[1] == '"' || p[1] == '\\')) {
+						*out++ = p[1];
+						p += 2;
+					} else if (p + 1 != end && p[1] == '\n') {
+						p += 2;
+					} else {
+						*out++ = *p++;
+					}
+				}
+			}
+		}
+		if (word)
+			words.emplace_back(word, out - word);
+		return std::string_view::npos;
+	}
+
+	// Index of the '=' in "-name=value" / "--name=value", npos for anything else
+	static size_t optional_split(std::string_view str)
+	{
+		// -{1,2} name '=' value, where name is runs of name chars joined by single '-'
+		const char * p = str.data();
+		const char * end = p + str.length();
+		if (p == end || *p != '-')
+			return std::string_view::npos;
+		++p;
+		if (p != end && *p == '-')
+			++p;
+		bool after_dash = true;
+		for (; p != end; ++p) {
+			if (is_name_char(*p)) {
+				after_dash = false;
+				continue;
+			}
+			if (*p == '-' && !after_dash) {
+				after_dash = true;
+				continue;
+			}
+			break;
+		}
+		// name must end with a name char and be followed by '=' and a non-empty value
+		if (!after_dash && p != end && *p == '=' && p + 1 != end)
+			return static_cast<size_t>(p - str.data());
+		return std::string_view::npos;
+	}
+
+	static inline std::string_view trim_quotes(std::string_view token)
+	{
+		if (token.length() >= 2 && has_class(token.front(), cQuote) && has_class(token.back(), cQuote)) {
+			token.remove_prefix(1);
+			token.remove_suffix(1);
+		}
+		return token;
+	}
+
+	std::string_view ArgumentParser::_parse_exec_name(std::string_view argv0) const
+	{
+		size_t sep = argv0.rfind(this->os_sep);
+		if (sep != std::string_view::npos)
+			argv0.remove_prefix(sep + 1);
+		return argv0;
+	}
+
+	void ArgumentParser::_start(ParseResult & result) const
+	{
+		result._parser = this;
+		result._slots.resize(this->_arguments.size());
+	}
+
+	bool ArgumentParser::_at_subcommand(std::string_view token, const Tokenizer & state) const
+	{
+		// a free token: no option waits for values and the positionals are filled
+		// (an interrupted trailing positional counts as filled)
+		if (state.pending >= 0 || state.collecting >= 0 || (state.positional < this->_positionals.size() && !state.positional_paused))
+			return false;
+		if (this->_response_format != ResponseFileFormat::fNone && !token.empty() && token.front() == this->_response_prefix)
+			return false;
+		return !is_option_token(token);
+	}
+
+	bool ArgumentParser::_tokenize(std::string_view token, Tokenizer & state) const
+	{
+		if (token == "--help" || token == "/?")
+			state.result._help = true;
+		// "--name=value" is two tokens
+		size_t split = optional_split(token);
+		if (split != std::string_view::npos)
+			return this->_feed(trim_quotes(token.substr(0, split)), state) && this->_feed(trim_quotes(token.substr(split + 1)), state);
+		return this->_feed(trim_quotes(token), state);
+	}
+
+	bool ArgumentParser::_feed(std::string_view token, Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		size_t index = result.sanitized_arguments.size();
+		result.sanitized_arguments.push_back(token);
+		result._token_argv.push_back(state.argv_index);
+		bool option = is_option_token(token);
+		// values of a nargs option run up to the next option
+		if (state.collecting >= 0) {
+			if (!option) {
+				if (++state.collected == this->_arguments[state.collecting].nargs_max)
+					return this->_close_collecting(state);
+				return true;
+			}
+			if (!this->_close_collecting(state))
+				return false;
+		}
+		// a single value is taken whatever it looks like
+		bool taken = false;
+		if (state.pending >= 0) {
+			ArgSlot & slot = result._slots[state.pending];
+			slot.arg_str_value = token;
+			slot.arg_token = static_cast<unsigned int>(index);
+			slot.arg_set = true;
+			state.pending = -1;
+			taken = true;
+		}
+		// positionals are the leading tokens, by index; a trailing one with a
+		// variable count also takes the free tokens after options
+		if (state.positional < this->_positionals.size() && !(taken && state.positional_paused)) {
+			this->_feed_positional(index, option, state);
+			taken = true;
+		}
+		// nothing takes it: an error, not dropped input
+		if (!taken && !option && state.positional_error.code == NO_ERROR)
+			state.positional_error = ParseError(UNKNOWN_ARGUMENT_ERROR, state.argv_index, token, nullptr);
+		if (option) {
+			this->_feed_option(token, index, state);
+			return state.error.code == NO_ERROR;
+		}
+		return true;
+	}
+
+	void ArgumentParser::_feed_positional(size_t index, bool option, Tokenizer & state) const
+	{
+		const ArgConfig & arg = this->_arguments[this->_positionals[state.positional]];
+		if (option) {
+			// a variable count (only the last positional has one) goes on after the option
+			if (arg.nargs_min != arg.nargs_max) {
+				state.positional_paused = true;
+				return;
+			}
+			if (state.positional_error.code == NO_ERROR) {
+				ArgErrorCode code = (arg.arg_nargs == ArgNargs::nOne) ? POSITIONAL_ERROR : NARGS_ERROR;
+				state.positional_error = ParseError(code, state.argv_index, state.result.sanitized_arguments[index], &arg);
+			}
+			state.positional = this->_positionals.size();
+			return;
+		}
+		if (state.positional_taken == 0)
+			state.positional_first = index;
+		else if (state.positional_first + state.positional_taken != index)
+			this->_gather_positional(index, state);
+		if (++state.positional_taken == arg.nargs_max)
+			this->_close_positional(state);
+	}
+
+	// Values of a positional are one run of tokens: when options come in between,
+	// the run so far and the new token are appended again after the last token
+	void ArgumentParser::_gather_positional(size_t index, Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		size_t first = result.sanitized_arguments.size();
+		result.sanitized_arguments.reserve(first + state.positional_taken + 1);
+		result._token_argv.reserve(first + state.positional_taken + 1);
+		for (size_t i = 0; i < state.positional_taken; ++i) {
+			result.sanitized_arguments.push_back(result.sanitized_arguments[state.positional_first + i]);
+			result._token_argv.push_back(result._token_argv[state.positional_first + i]);
+		}
+		result.sanitized_arguments.push_back(result.sanitized_arguments[index]);
+		result._token_argv.push_back(result._token_argv[index]);
+		state.positional_first = first;
+	}
+
+	void ArgumentParser::_feed_option(std::string_view token, size_t index, Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		size_t dashes = std::min(token.find_first_not_of('-'), token.size());
+		token.remove_prefix(dashes);
+		// "-abc" is a cluster of short options, unless an option has that whole name
+		if (dashes == 1 && token.size() > 1 && this->_find_short(token.front()) >= 0 && this->_find(token) < 0) {
+			this->_feed_cluster(token, index, state);
+			return;
+		}
+		int found = this->_find_option(token);
+		ARGPARSE_COUNT(result, lookups, 1);
+		if (found == -2)
+			state.error = ParseError(AMBIGUOUS_OPTION_ERROR, state.argv_index, result.sanitized_arguments[index], nullptr);
+		if (found < 0)
+			return;
+		this->_take_option(static_cast<unsigned int>(found), index, state);
+	}
+
+	// Short options one character at a time, the first one taking values gets the
+	// rest of the token as its first value ("-ofile", "-j8") or the next tokens
+	void ArgumentParser::_feed_cluster(std::string_view token, size_t index, Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		for (size_t i = 0; i < token.size(); ++i) {
+			int found = this->_find_short(token[i]);
+			ARGPARSE_COUNT(result, lookups, 1);
+			if (found < 0) {
+				state.error = ParseError(SHORT_OPTION_ERROR, state.argv_index, token.substr(i, 1), nullptr);
+				return;
+			}
+			if (this->_take_option(static_cast<unsigned int>(found), index, state) || i + 1 == token.size())
+				continue;
+			// the value is a token of its own, right after the cluster
+			std::string_view value = token.substr(i + 1);
+			result.sanitized_arguments.push_back(value);
+			result._token_argv.push_back(state.argv_index);
+			if (state.pending >= 0) {
+				ArgSlot & slot = result._slots[state.pending];
+				slot.arg_str_value = value;
+				slot.arg_token = static_cast<unsigned int>(index + 1);
+				slot.arg_set = true;
+				state.pending = -1;
+			} else if (++state.collected == this->_arguments[state.collecting].nargs_max) {
+				this->_close_collecting(state);
+			}
+			return;
+		}
+	}
+
+	// Sets a flag or count, or makes the option wait for its values; false for the latter
+	bool ArgumentParser::_take_option(unsigned int found, size_t index, Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		const ArgConfig & arg = this->_arguments[found];
+		ArgSlot & slot = result._slots[found];
+		if (arg.arg_sb == ArgSpecialBehavior::DROP_POSITIONAL_CHECK)
+			result._drop_positional = true;
+		// Optional types WITHOUT value
+		if (arg.arg_type == ArgType::tStoreTrue) {
+			slot.arg_str_value = "<store_true>";
+			slot.arg_set = true;
+			return true;
+		}
+		if (arg.arg_type == ArgType::tStoreFalse) {
+			slot.arg_str_value = "<store_false>";
+			slot.arg_set = true;
+			return true;
+		}
+		if (arg.arg_type == ArgType::tCount) {
+			// occurrences are kept in list_size, unused by single values
+			slot.arg_str_value = "<count>";
+			++slot.list_size;
+			slot.arg_set = true;
+			return true;
+		}
+		state.option_token = index;
+		// Optional types with nargs values, up to the next option
+		if (arg.arg_nargs != ArgNargs::nOne) {
+			state.collecting = static_cast<int>(found);
+			state.collect_first = index + 1;
+			state.collected = 0;
+			return false;
+		}
+		// Optional types WITH value: the next token
+		state.pending = static_cast<int>(found);
+		return false;
+	}
+
+	bool ArgumentParser::_close_collecting(Tokenizer & state) const
+	{
+		const ArgConfig & arg = this->_arguments[state.collecting];
+		ArgSlot & slot = state.result._slots[state.collecting];
+		if (state.collected < arg.nargs_min) {
+			state.error = ParseError(NARGS_ERROR, state.result._token_argv[state.option_token], state.result.sanitized_arguments[state.option_token], &arg);
+			return false;
+		}
+		slot.arg_set = true;
+		if (arg.is_list()) {
+			slot.list_offset = static_cast<unsigned int>(state.collect_first);
+			slot.list_size = static_cast<unsigned int>(state.collected);
+		} else {
+			// without a value the option's own token stands in, collect_first may be past the end
+			slot.arg_str_value = state.collected ? state.result.sanitized_arguments[state.collect_first] : std::string_view();
+			slot.arg_token = static_cast<unsigned int>(state.collected ? state.collect_first : state.option_token);
+		}
+		state.collecting = -1;
+		return true;
+	}
+
+	void ArgumentParser::_close_positional(Tokenizer & state) const
+	{
+		const ArgConfig & arg = this->_arguments[this->_positionals[state.positional]];
+		ArgSlot & slot = state.result._slots[this->_positionals[state.positional]];
+		if (arg.is_list()) {
+			slot.list_offset = static_cast<unsigned int>(state.positional_first);
+			slot.list_size = static_cast<unsigned int>(state.positional_taken);
+		} else if (state.positional_taken != 0) {
+			slot.arg_str_value = state.result.sanitized_arguments[state.positional_first];
+			slot.arg_token = static_cast<unsigned int>(state.positional_first);
+		}
+		// an absent '?' or '*' positional is not given
+		slot.arg_set = state.positional_taken != 0;
+		++state.positional;
+		state.positional_taken = 0;
+		state.positional_paused = false;
+	}
+
+	// Missing values and positionals, checked once the tokens are in
+	ParseError ArgumentParser::_validate(Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		if (state.collecting >= 0 && !this->_close_collecting(state))
+			return state.error;
+		if (state.pending >= 0) {
+			return ParseError(OPTIONAL_PROVIDED_WITH_NO_VALUE, result._token_argv[state.option_token],
+				result.sanitized_arguments[state.option_token], &this->_arguments[state.pending]);
+		}
+		if (result._drop_positional || result._help) {
+			for (auto it = this->_positionals.begin(); it != this->_positionals.end(); ++it)
+				result._slots[*it] = ArgSlot();
+		} else {
+			if (this->_positional_min > result.sanitized_arguments.size())
+				return ParseError(POSITIONAL_ERROR, -1, std::string_view(), nullptr);
+			if (state.positional_error.code != NO_ERROR)
+				return state.positional_error;
+			// last positional with a variable count still open
+			if (state.positional < this->_positionals.size()) {
+				const ArgConfig & arg = this->_arguments[this->_positionals[state.positional]];
+				if (state.positional_taken < arg.nargs_min)
+					return ParseError(NARGS_ERROR, -1, std::string_view(), &arg);
+				this->_close_positional(state);
+			}
+		}
+		return ParseError();
+	}
+
+	ParseError ArgumentParser::_finish(Tokenizer & state) const
+	{
+		ParseResult & result = state.result;
+		if (state.error.code != NO_ERROR)
+			return state.error;
+		ARGPARSE_COUNT(result, tokens, result.sanitized_arguments.size());
+		{
+			ARGPARSE_PHASE(result, pValidate);
+			ParseError error = this->_validate(state);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		if (this->_has_env || !this->_config_path.empty()) {
+			ARGPARSE_PHASE(result, pSources);
+			ParseError error = this->_apply_sources(result);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		if (!this->_rules.empty() && !result._help && !result._drop_positional) {
+			ARGPARSE_PHASE(result, pValidate);
+			ParseError error = this->_check_rules(result);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		// Convert arguments, or leave it to get_arg()
+		if (this->_lazy_conversion) {
+			this->_reserve_lists(result);
+		} else {
+			ARGPARSE_PHASE(result, pConvert);
+			ParseError error = this->_convert_arguments(result);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		if (!this->_bindings.empty()) {
+			ARGPARSE_PHASE(result, pBind);
+			return this->_store_bindings(result, state.object);
+		}
+		return ParseError();
+	}
+
+	static inline std::string_view trim_blanks(std::string_view str)
+	{
+		while (!str.empty() && has_class(str.front(), cBlank))
+			str.remove_prefix(1);
+		while (!str.empty() && has_class(str.back(), cBlank))
+			str.remove_suffix(1);
+		return str;
+	}
+
+	// 1/0, true/false, yes/no, on/off in any case; false for anything else
+	static bool parse_switch(std::string_view str, bool & value)
+	{
+		static const char * const on[] = { "1", "true", "yes", "on" };
+		static const char * const off[] = { "0", "false", "no", "off" };
+		auto equal = [str](const char * word) {
+			size_t i = 0;
+			for (; i < str.size() && word[i]; ++i) {
+				if (::tolower(static_cast<unsigned char>(str[i])) != word[i])
+					return false;
+			}
+			return i == str.size() && !word[i];
+		};
+		for (size_t i = 0; i < 4; ++i) {
+			if (equal(on[i]) || equal(off[i])) {
+				value = equal(on[i]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Environment and config file values of the optionals argv left unset
+	ParseError ArgumentParser::_apply_sources(ParseResult & result) const
+	{
+		if (!this->_config_path.empty()) {
+			ParseError error = this->_apply_config_file(result);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		if (!this->_has_env)
+			return ParseError();
+		for (size_t i = 0; i < this->_arguments.size(); ++i) {
+			const ArgConfig & arg = this->_arguments[i];
+			if (arg.arg_env.empty())
+				continue;
+			const ArgSlot & slot = result._slots[i];
+			if (slot.arg_set && !slot.arg_sourced)
+				continue;
+			const char * value = std::getenv(arg.arg_env.data());
+			if (!value)
+				continue;
+			ParseError error = this->_set_from_source(result, i, value);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		return ParseError();
+	}
+
+	ParseError ArgumentParser::_apply_config_file(ParseResult & result) const
+	{
+		MappedFile file;
+		if (!file.open(this->_config_path.c_str())) {
+			if (!this->_config_required)
+				return ParseError();
+			return ParseError(CONFIG_FILE_ERROR, -1, this->_config_path, nullptr);
+		}
+		// the mapping doesn't move with the MappedFile, views stay valid
+		std::string_view data = file.view();
+		result._files.push_back(std::move(file));
+
+		std::string_view section;
+		char key_buffer[256];
+		std::string long_key;	// "section.key" that doesn't fit key_buffer
+		size_t begin = 0;
+		while (begin < data.size()) {
+			size_t end = data.find('\n', begin);
+			if (end == std::string_view::npos)
+				end = data.size();
+			std::string_view line = trim_blanks(data.substr(begin, end - begin));
+			begin = end + 1;
+			if (line.empty() || line.front() == '#' || line.front() == ';')
+				continue;
+			if (line.front() == '[') {
+				size_t close = line.find(']');
+				section = trim_blanks(line.substr(1, close == std::string_view::npos ? std::string_view::npos : close - 1));
+				continue;
+			}
+			size_t equal = line.find('=');
+			if (equal == std::string_view::npos)
+				continue;
+			std::string_view key = trim_blanks(line.substr(0, equal));
+			std::string_view value = trim_blanks(line.substr(equal + 1));
+			if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+				value = value.substr(1, value.size() - 2);
+			// "section.key", assembled on the stack unless it is too long for the buffer
+			if (!section.empty() && section.size() + 1 + key.size() > sizeof(key_buffer)) {
+				long_key.assign(section.data(), section.size());
+				long_key += '.';
+				long_key.append(key.data(), key.size());
+				key = long_key;
+			} else if (!section.empty()) {
+				std::memcpy(key_buffer, section.data(), section.size());
+				key_buffer[section.size()] = '.';
+				std::memcpy(key_buffer + section.size() + 1, key.data(), key.size());
+				key = std::string_view(key_buffer, section.size() + 1 + key.size());
+			}
+			int found = this->_find_key(key);
+			if (found < 0)
+				continue;
+			// argv wins, a later line wins over an earlier one
+			const ArgSlot & slot = result._slots[found];
+			if (slot.arg_set && !slot.arg_sourced)
+				continue;
+			ParseError error = this->_set_from_source(result, found, value);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		return ParseError();
+	}
+
+	// Gives an optional a value from outside argv. The value becomes a token with
+	// argv index -1, so conversion and error reports treat it like an argv value.
+	ParseError ArgumentParser::_set_from_source(ParseResult & result, size_t index, std::string_view value) const
+	{
+		const ArgConfig & arg = this->_arguments[index];
+		ArgSlot & slot = result._slots[index];
+		unsigned int token = static_cast<unsigned int>(result.sanitized_arguments.size());
+		if (arg.arg_type == ArgType::tStoreTrue || arg.arg_type == ArgType::tStoreFalse) {
+			bool given;
+			if (!parse_switch(value, given))
+				return ParseError(CONVERT_ARG_ERROR, -1, value, &arg);
+			slot = ArgSlot();
+			if (!given)
+				return ParseError();
+			slot.arg_str_value = value;
+		} else if (arg.arg_type == ArgType::tCount) {
+			int count;
+			ArgErrorCode code = convert_arg(value, count);
+			if (code != NO_ERROR)
+				return ParseError(code, -1, value, &arg);
+			if (count < 0)
+				return ParseError(CONVERT_ARG_RANGE_ERROR, -1, value, &arg);
+			slot = ArgSlot();
+			slot.arg_str_value = value;
+			slot.list_size = static_cast<unsigned int>(count);
+		} else if (arg.is_list()) {
+			// values separated by blanks or commas
+			size_t count = 0;
+			size_t begin = 0;
+			while (begin < value.size()) {
+				size_t end = value.find_first_of(" \t,", begin);
+				if (end == std::string_view::npos)
+					end = value.size();
+				if (end != begin) {
+					result.sanitized_arguments.push_back(value.substr(begin, end - begin));
+					result._token_argv.push_back(-1);
+					++count;
+				}
+				begin = end + 1;
+			}
+			if (count < arg.nargs_min || count > arg.nargs_max)
+				return ParseError(NARGS_ERROR, -1, value, &arg);
+			slot.list_offset = token;
+			slot.list_size = static_cast<unsigned int>(count);
+			slot.arg_token = token;
+			slot.arg_set = true;
+			slot.arg_sourced = true;
+			return ParseError();
+		} else {
+			slot.arg_str_value = value;
+		}
+		result.sanitized_arguments.push_back(value);
+		result._token_argv.push_back(-1);
+		slot.arg_token = token;
+		slot.arg_set = true;
+		slot.arg_sourced = true;
+		return ParseError();
+	}
+
+	ParseError ArgumentParser::_store_bindings(const ParseResult & result, void * object) const
+	{
+		// Lazy mode: bound values are needed now, convert all before writing any
+		if (this->_lazy_conversion) {
+			for (auto it = this->_bindings.begin(); it != this->_bindings.end(); ++it) {
+				ParseError error = this->_convert_argument(result, it->index);
+				if (error.code != NO_ERROR)
+					return error;
+			}
+		}
+		for (auto it = this->_bindings.begin(); it != this->_bindings.end(); ++it) {
+			void * place = it->target;
+			if (!place && object && it->locate)
+				place = it->locate(object, it->member);
+			if (!place)
+				continue;
+			const ArgSlot & slot = result._slots[it->index];
+			if (!slot.arg_set && !it->has_default)
+				continue;
+			switch (it->kind) {
+			case ArgBindKind::bValue:
+				std::memcpy(place, slot.arg_set ? &slot.arg_value : &it->default_value, it->size);
+				break;
+			case ArgBindKind::bString:
+				static_cast<std::string *>(place)->assign(slot.arg_set ? slot.arg_str_value : it->default_str);
+				ARGPARSE_COUNT(result, bytes_copied, static_cast<std::string *>(place)->size());
+				break;
+			case ArgBindKind::bStringView:
+				*static_cast<std::string_view *>(place) = slot.arg_set ? slot.arg_str_value : it->default_str;
+				break;
+			}
+		}
+		return ParseError();
+	}
+
+	static std::string convert_error_message(const ArgConfig & obj, std::string_view value, ArgErrorCode code)
+	{
+		std::string ret = (code == CONVERT_ARG_RANGE_ERROR)
+			? "Value of argument '" + std::string(obj.arg_name) + "' out of range for "
+			: "Can't convert argument '" + std::string(obj.arg_name) + "' to ";
+		if (obj.arg_type == ArgType::tInt || obj.arg_type == ArgType::tCount)
+			ret += "int";
+		if (obj.arg_type == ArgType::tInt64)
+			ret += "int64";
+		if (obj.arg_type == ArgType::tUInt64)
+			ret += "uint64";
+		if (obj.arg_type == ArgType::tFloat)
+			ret += "float";
+		if (obj.arg_type == ArgType::tDouble)
+			ret += "double";
+		ret += " | provided value: " + std::string(value);
+		return ret;
+	}
+
+	static inline unsigned char lower_ascii(unsigned char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+	}
+
+	// Levenshtein distance ignoring case, one row of the table at a time
+	static size_t edit_distance(std::string_view a, std::string_view b)
+	{
+		std::vector<size_t> row(b.size() + 1);
+		for (size_t j = 0; j <= b.size(); ++j)
+			row[j] = j;
+		for (size_t i = 1; i <= a.size(); ++i) {
+			size_t diagonal = row[0];
+			row[0] = i;
+			for (size_t j = 1; j <= b.size(); ++j) {
+				size_t above = row[j];
+				bool same = lower_ascii(static_cast<unsigned char>(a[i - 1])) == lower_ascii(static_cast<unsigned char>(b[j - 1]));
+				row[j] = std::min(std::min(above, row[j - 1]) + 1, diagonal + (same ? 0 : 1));
+				diagonal = above;
+			}
+		}
+		return row[b.size()];
+	}
+
+	static std::string choice_error_message(const ArgConfig & obj, std::string_view value)
+	{
+		// the closest choice, the first one on a tie
+		std::string_view closest;
+		size_t best = std::numeric_limits<size_t>::max();
+		std::string_view names = obj.arg_choices;
+		while (!names.empty()) {
+			size_t end = std::min(names.find(','), names.size());
+			size_t distance = edit_distance(value, names.substr(0, end));
+			if (distance < best) {
+				best = distance;
+				closest = names.substr(0, end);
+			}
+			names.remove_prefix(std::min(end + 1, names.size()));
+		}
+		return "Invalid choice for argument '" + std::string(obj.arg_name) + "' | provided value: " + std::string(value)
+			+ " | did you mean '" + std::string(closest) + "'?";
+	}
+
+	ParseError ArgumentParser::_convert_arguments(const ParseResult & result) const
+	{
+		for (size_t index = 0; index < this->_arguments.size(); ++index) {
+			ParseError error = this->_convert_argument(result, index);
+			if (error.code != NO_ERROR)
+				return error;
+		}
+		return ParseError();
+	}
+
+	ParseError ArgumentParser::_convert_argument(const ParseResult & result, size_t index) const
+	{
+		const ArgConfig & arg = this->_arguments[index];
+		ArgSlot & slot = result._slots[index];
+		if (slot.arg_converted)
+			return ParseError();
+		ArgErrorCode code = NO_ERROR;
+		if (arg.is_list()) {
+			if (slot.arg_set) {
+				size_t failed = 0;
+				switch (arg.arg_type) {
+				case ArgType::tInt:
+					code = convert_list(result.sanitized_arguments, slot, result._int_list, failed);
+					break;
+				case ArgType::tInt64:
+					code = convert_list(result.sanitized_arguments, slot, result._int64_list, failed);
+					break;
+				case ArgType::tUInt64:
+					code = convert_list(result.sanitized_arguments, slot, result._uint64_list, failed);
+					break;
+				case ArgType::tFloat:
+					code = convert_list(result.sanitized_arguments, slot, result._float_list, failed);
+					break;
+				case ArgType::tDouble:
+					code = convert_list(result.sanitized_arguments, slot, result._double_list, failed);
+					break;
+				default:
+					break;
+				}
+				if (code != NO_ERROR)
+					return ParseError(code, result._token_argv[failed], result.sanitized_arguments[failed], &arg);
+			}
+			slot.arg_converted = true;
+			return ParseError();
+		}
+		// nargs '?' given without a value keeps the default
+		if (slot.arg_set && slot.arg_str_value.empty() && arg.arg_nargs == ArgNargs::nOptional) {
+			slot.arg_converted = true;
+			return ParseError();
+		}
+		switch (arg.arg_type) {
+		case ArgType::tString:
+			break;
+		case ArgType::tInt:
+			if (slot.arg_set)
+				code = convert_arg(slot.arg_str_value, slot.arg_value.as_int);
+			break;
+		case ArgType::tInt64:
+			if (slot.arg_set)
+				code = convert_arg(slot.arg_str_value, slot.arg_value.as_int64);
+			break;
+		case ArgType::tUInt64:
+			if (slot.arg_set)
+				code = convert_arg(slot.arg_str_value, slot.arg_value.as_uint64);
+			break;
+		case ArgType::tFloat:
+			if (slot.arg_set)
+				code = convert_arg(slot.arg_str_value, slot.arg_value.as_float);
+			break;
+		case ArgType::tDouble:
+			if (slot.arg_set)
+				code = convert_arg(slot.arg_str_value, slot.arg_value.as_double);
+			break;
+		case ArgType::tStoreTrue:
+			slot.arg_value.as_bool = slot.arg_set;
+			break;
+		case ArgType::tStoreFalse:
+			slot.arg_value.as_bool = !slot.arg_set;
+			break;
+		case ArgType::tCount:
+			slot.arg_value.as_int = static_cast<int>(slot.list_size);
+			break;
+		case ArgType::tChoice:
+			if (slot.arg_set) {
+				const ArgChoiceSet & set = this->_choice_sets[arg.choice_set];
+				int found = this->_find_choice(set, slot.arg_str_value);
+				if (found < 0)
+					code = CHOICE_ERROR;
+				else
+					slot.arg_value.as_int = this->_choices[set.first + found].value;
+			}
+			break;
+		}
+		if (code != NO_ERROR) {
+			int argv_index = slot.arg_token < result._token_argv.size() ? result._token_argv[slot.arg_token] : -1;
+			return ParseError(code, argv_index, slot.arg_str_value, &arg);
+		}
+		slot.arg_converted = true;
+		return ParseError();
+	}
+
+	void ArgumentParser::_reserve_lists(ParseResult & result) const
+	{
+		// lists converted later append to these; reserving all of it up front keeps
+		// spans handed out by earlier get_list() calls valid
+		size_t sizes[5] = { 0, 0, 0, 0, 0 };
+		for (size_t index = 0; index < this->_arguments.size(); ++index) {
+			const ArgConfig & arg = this->_arguments[index];
+			if (!arg.is_list() || !result._slots[index].arg_set)
+				continue;
+			size_t size = result._slots[index].list_size;
+			switch (arg.arg_type) {
+			case ArgType::tInt:
+				sizes[0] += size;
+				break;
+			case ArgType::tInt64:
+				sizes[1] += size;
+				break;
+			case ArgType::tUInt64:
+				sizes[2] += size;
+				break;
+			case ArgType::tFloat:
+				sizes[3] += size;
+				break;
+			case ArgType::tDouble:
+				sizes[4] += size;
+				break;
+			default:
+				break;
+			}
+		}
+		result._int_list.reserve(sizes[0]);
+		result._int64_list.reserve(sizes[1]);
+		result._uint64_list.reserve(sizes[2]);
+		result._float_list.reserve(sizes[3]);
+		result._double_list.reserve(sizes[4]);
+	}
+
+	static inline unsigned int hash_name(std::string_view name)
+	{
+		// FNV-1a
+		unsigned int hash = 2166136261u;
+		for (auto it = name.begin(); it != name.end(); ++it) {
+			hash ^= static_cast<unsigned char>(*it);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Open addressing index over a table of named entries: each slot holds
+	// 1 + the entry's position, 0 is empty. name_of(i) is the name of entry i.
+	template <typename NameOf>
+	static int index_find(const std::pmr::vector<unsigned int> & index, std::string_view name, NameOf name_of)
+	{
+		if (index.empty())
+			return -1;
+		size_t mask = index.size() - 1;
+		for (size_t slot = hash_name(name) & mask; ; slot = (slot + 1) & mask) {
+			unsigned int entry = index[slot];
+			if (entry == 0)
+				return -1;
+			if (name_of(entry - 1) == name)
+				return static_cast<int>(entry - 1);
+		}
+	}
+
+	template <typename NameOf>
+	static void index_insert(std::pmr::vector<unsigned int> & index, unsigned int position, NameOf name_of)
+	{
+		// keep load factor <= 1/2, rebuild on growth
+		if (2 * (position + 1) > index.size()) {
+			index.assign(index.empty() ? 16 : 2 * index.size(), 0);
+			for (unsigned int i = 0; i < position; ++i)
+				index_insert(index, i, name_of);
+		}
+		size_t mask = index.size() - 1;
+		size_t slot = hash_name(name_of(position)) & mask;
+		while (index[slot] != 0)
+			slot = (slot + 1) & mask;
+		index[slot] = position + 1;
+	}
+
+	int ArgumentParser::_find(std::string_view name) const
+	{
+		return index_find(this->_arg_index, name, [this](unsigned int i) { return this->_arguments[i].arg_name; });
+	}
+
+	void ArgumentParser::_index_insert(unsigned int index)
+	{
+		index_insert(this->_arg_index, index, [this](unsigned int i) { return this->_arguments[i].arg_name; });
+		this->_widen_rules();
+		this->_schema_changed();
+		ArgConfig & arg = this->_arguments[index];
+		arg.arg_key = arg.arg_name;
+		index_insert(this->_key_index, index, [this](unsigned int i) { return this->_arguments[i].arg_key; });
+		if (arg.arg_imp == ArgImportance::iOptional) {
+			this->_trie_insert(arg.arg_name, index);
+			// "-v" for an optional named "v" goes through the short table too
+			if (arg.arg_name.size() == 1 && this->_find_short(arg.arg_name.front()) == -1
+				&& static_cast<unsigned char>(arg.arg_name.front()) < 128)
+				this->_short_index[static_cast<unsigned char>(arg.arg_name.front())] = static_cast<unsigned short>(index + 1);
+			if (!this->_env_prefix.empty())
+				this->_set_env_name(arg);
+		}
+	}
+
+	static inline unsigned int popcount64(std::uint64_t bits)
+	{
+		unsigned int count = 0;
+		for (; bits; bits &= bits - 1)
+			++count;
+		return count;
+	}
+
+	static inline unsigned int lowest_bit64(std::uint64_t bits)
+	{
+		unsigned int index = 0;
+		for (; !(bits & 1); bits >>= 1)
+			++index;
+		return index;
+	}
+
+	unsigned int ArgumentParser::_rule_arg(std::string_view arg_name) const
+	{
+		int found = this->_find(arg_name);
+		if (found < 0)
+			throw Error(UNKNOWN_ARGUMENT_ERROR, "No argument '" + std::string(arg_name) + "'");
+		return static_cast<unsigned int>(found);
+	}
+
+	// Mask of the rule of that kind and subject, added if there is none yet.
+	// Requirements and conflicts of one subject share a rule, as do all required ones.
+	std::uint64_t * ArgumentParser::_rule(ArgRuleKind kind, unsigned int subject, std::string_view names)
+	{
+		size_t index = this->_rules.size();
+		if (kind == ArgRuleKind::rRequired || kind == ArgRuleKind::rRequires || kind == ArgRuleKind::rConflicts) {
+			for (size_t i = 0; i < this->_rules.size(); ++i) {
+				if (this->_rules[i].kind == kind && this->_rules[i].subject == subject)
+					index = i;
+			}
+		}
+		if (index == this->_rules.size()) {
+			this->_rules.push_back(ArgRule{ kind, subject, this->_intern(names) });
+			this->_rule_masks.resize(this->_rule_masks.size() + this->_rule_width, 0);
+		}
+		return this->_rule_masks.data() + index * this->_rule_width;
+	}
+
+	// One more mask word per rule once the arguments outgrow the masks
+	void ArgumentParser::_widen_rules()
+	{
+		size_t width = (this->_arguments.size() + 63) / 64;
+		if (width <= this->_rule_width)
+			return;
+		std::pmr::vector<std::uint64_t> masks(this->_rules.size() * width, 0, &this->_arena);
+		for (size_t rule = 0; rule < this->_rules.size(); ++rule) {
+			for (size_t word = 0; word < this->_rule_width; ++word)
+				masks[rule * width + word] = this->_rule_masks[rule * this->_rule_width + word];
+		}
+		this->_rule_masks.swap(masks);
+		this->_rule_width = width;
+	}
+
+	static inline void set_bit(std::uint64_t * mask, unsigned int index)
+	{
+		mask[index >> 6] |= std::uint64_t(1) << (index & 63);
+	}
+
+	void ArgumentParser::set_required(std::string_view arg_name)
+	{
+		unsigned int arg = this->_rule_arg(arg_name);
+		set_bit(this->_rule(ArgRuleKind::rRequired, 0, std::string_view()), arg);
+	}
+
+	void ArgumentParser::add_exclusive_group(const std::vector<std::string_view> & arg_names, bool required)
+	{
+		alignas(std::max_align_t) unsigned char stack[256];
+		std::pmr::monotonic_buffer_resource scratch(stack, sizeof(stack), &this->_arena);
+		std::pmr::string names(&scratch);
+		for (auto it = arg_names.begin(); it != arg_names.end(); ++it) {
+			this->_rule_arg(*it);
+			names += names.empty() ? "'" : ", '";
+			names += *it;
+			names += '\'';
+		}
+		std::uint64_t * mask = this->_rule(required ? ArgRuleKind::rOneOf : ArgRuleKind::rExclusive, 0, names);
+		for (auto it = arg_names.begin(); it != arg_names.end(); ++it)
+			set_bit(mask, this->_rule_arg(*it));
+	}
+
+	void ArgumentParser::add_requires(std::string_view arg_name, std::string_view required_name)
+	{
+		unsigned int arg = this->_rule_arg(arg_name);
+		unsigned int required = this->_rule_arg(required_name);
+		set_bit(this->_rule(ArgRuleKind::rRequires, arg, std::string_view()), required);
+	}
+
+	void ArgumentParser::add_conflicts(std::string_view arg_name, std::string_view other_name)
+	{
+		unsigned int arg = this->_rule_arg(arg_name);
+		unsigned int other = this->_rule_arg(other_name);
+		set_bit(this->_rule(ArgRuleKind::rConflicts, arg, std::string_view()), other);
+	}
+
+	ParseError ArgumentParser::_check_rules(ParseResult & result) const
+	{
+		size_t width = this->_rule_width;
+		std::pmr::vector<std::uint64_t> & present = result._present;
+		present.assign(width, 0);
+		for (size_t i = 0; i < this->_arguments.size(); ++i) {
+			if (result._slots[i].arg_set)
+				set_bit(present.data(), static_cast<unsigned int>(i));
+		}
+		auto given = [&present](unsigned int index) {
+			return (present[index >> 6] >> (index & 63)) & 1;
+		};
+		const std::uint64_t * mask = this->_rule_masks.data();
+		for (auto rule = this->_rules.begin(); rule != this->_rules.end(); ++rule, mask += width) {
+			bool subject = rule->kind == ArgRuleKind::rRequires || rule->kind == ArgRuleKind::rConflicts;
+			if (subject && !given(rule->subject))
+				continue;
+			const ArgConfig * first = nullptr;
+			unsigned int count = 0;
+			for (size_t word = 0; word < width; ++word) {
+				std::uint64_t bits = (rule->kind == ArgRuleKind::rRequired || rule->kind == ArgRuleKind::rRequires)
+					? mask[word] & ~present[word]	// missing
+					: mask[word] & present[word];	// given
+				if (!bits)
+					continue;
+				const ArgConfig * arg = &this->_arguments[word * 64 + lowest_bit64(bits)];
+				switch (rule->kind) {
+				case ArgRuleKind::rRequired:
+					return ParseError(REQUIRED_ERROR, -1, std::string_view(), arg);
+				case ArgRuleKind::rRequires:
+					return ParseError(REQUIRES_ERROR, -1, std::string_view(), &this->_arguments[rule->subject], arg);
+				case ArgRuleKind::rConflicts:
+					return ParseError(CONFLICT_ERROR, -1, std::string_view(), &this->_arguments[rule->subject], arg);
+				default:
+					// groups: the first two given
+					if (first)
+						return ParseError(EXCLUSIVE_ERROR, -1, std::string_view(), first, arg);
+					first = arg;
+					count += popcount64(bits);
+					if (count > 1) {
+						bits &= bits - 1;
+						return ParseError(EXCLUSIVE_ERROR, -1, std::string_view(), first, &this->_arguments[word * 64 + lowest_bit64(bits)]);
+					}
+				}
+			}
+			if (rule->kind == ArgRuleKind::rOneOf && count == 0)
+				return ParseError(REQUIRED_ERROR, -1, rule->names, nullptr);
+		}
+		return ParseError();
+	}
+
+	// Optional by config file key, -1 for none
+	int ArgumentParser::_find_key(std::string_view key) const
+	{
+		int found = index_find(this->_key_index, key, [this](unsigned int i) { return this->_arguments[i].arg_key; });
+		if (found < 0 || key.empty() || this->_arguments[found].arg_imp != ArgImportance::iOptional)
+			return -1;
+		return found;
+	}
+
+	void ArgumentParser::_rebuild_key_index()
+	{
+		this->_key_index.clear();
+		for (unsigned int i = 0; i < this->_arguments.size(); ++i)
+			index_insert(this->_key_index, i, [this](unsigned int i) { return this->_arguments[i].arg_key; });
+	}
+
+	void ArgumentParser::_set_env_name(ArgConfig & arg)
+	{
+		// written straight into the arena, NUL-terminated like _intern()
+		size_t size = this->_env_prefix.size() + arg.arg_name.size();
+		char * name = static_cast<char *>(this->_arena.allocate(size + 1, 1));
+		std::memcpy(name, this->_env_prefix.data(), this->_env_prefix.size());
+		char * out = name + this->_env_prefix.size();
+		for (auto it = arg.arg_name.begin(); it != arg.arg_name.end(); ++it)
+			*out++ = (*it == '-') ? '_' : static_cast<char>(::toupper(static_cast<unsigned char>(*it)));
+		*out = '\0';
+		arg.arg_env = std::string_view(name, size);
+		this->_has_env = true;
+	}
+
+	void ArgumentParser::set_env(std::string_view arg_name, std::string_view env_var)
+	{
+		int found = this->_find(arg_name);
+		if (found < 0 || this->_arguments[found].arg_imp != ArgImportance::iOptional)
+			throw Error(CONFIG_FILE_ERROR, "No optional argument '" + std::string(arg_name) + "'");
+		this->_arguments[found].arg_env = this->_intern(env_var);
+		this->_has_env = true;
+	}
+
+	// Hash of a choice name; seed 0 picks the bucket, a bucket's displacement the slot
+	static inline unsigned int hash_choice(std::string_view name, unsigned int seed, bool ignore_case)
+	{
+		// FNV-1a from a seeded basis, mixed so that nearby seeds give unrelated hashes
+		unsigned int hash = 2166136261u ^ (seed * 0x9e3779b9u);
+		for (auto it = name.begin(); it != name.end(); ++it) {
+			unsigned char c = static_cast<unsigned char>(*it);
+			hash ^= ignore_case ? lower_ascii(c) : c;
+			hash *= 16777619u;
+		}
+		hash ^= hash >> 15;
+		hash *= 0x2c1b3c6du;
+		hash ^= hash >> 12;
+		return hash;
+	}
+
+	// hash scaled to [0, count) without a division
+	static inline unsigned int hash_range(unsigned int hash, unsigned int count)
+	{
+		return static_cast<unsigned int>((static_cast<std::uint64_t>(hash) * count) >> 32);
+	}
+
+	static inline bool same_choice(std::string_view a, std::string_view b, bool ignore_case)
+	{
+		if (a.size() != b.size())
+			return false;
+		if (!ignore_case)
+			return a == b;
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (lower_ascii(static_cast<unsigned char>(a[i])) != lower_ascii(static_cast<unsigned char>(b[i])))
+				return false;
+		}
+		return true;
+	}
+
+	void ArgumentParser::_add_choices(std::string_view arg_name, std::string_view arg_help, size_t first,
+									  ArgImportance arg_imp, bool ignore_case)
+	{
+		// _choices[first, end) were appended by add_choices(), names still the caller's
+		size_t count = this->_choices.size() - first;
+		size_t names_size = 0;
+		try {
+			if (count == 0)
+				throw Error(CHOICE_ERROR, "Argument '" + std::string(arg_name) + "' needs choices");
+			for (size_t i = 0; i < count; ++i) {
+				std::string_view name = this->_choices[first + i].name;
+				if (name.empty() || name.find(',') != std::string_view::npos)
+					throw Error(CHOICE_ERROR, "Invalid choice '" + std::string(name) + "' for '" + std::string(arg_name) + "'");
+				for (size_t j = 0; j < i; ++j) {
+					if (same_choice(name, this->_choices[first + j].name, ignore_case))
+						throw Error(DUPLICATE_ARGUMENT_ERROR, "Duplicate choice '" + std::string(name) + "'");
+				}
+				names_size += (i ? 1 : 0) + name.size();
+			}
+			this->add_argument(arg_name, arg_help, ArgType::tString, arg_imp);
+		} catch (...) {
+			this->_choices.resize(first);
+			throw;
+		}
+		// "a,b,c" for the help, written straight into the arena like _intern()
+		char * names = static_cast<char *>(this->_arena.allocate(names_size + 1, 1));
+		char * out = names;
+		for (size_t i = 0; i < count; ++i) {
+			ArgChoice & choice = this->_choices[first + i];
+			if (i)
+				*out++ = ',';
+			std::memcpy(out, choice.name.data(), choice.name.size());
+			choice.name = std::string_view(out, choice.name.size());
+			out += choice.name.size();
+		}
+		*out = '\0';
+		ArgChoiceSet set;
+		set.first = static_cast<unsigned int>(first);
+		set.count = static_cast<unsigned int>(count);
+		set.table = static_cast<unsigned int>(this->_choice_table.size());
+		set.ignore_case = ignore_case;
+		this->_hash_choices(set);
+		ArgConfig & arg = this->_arguments.back();
+		arg.arg_type = ArgType::tChoice;
+		arg.arg_choices = std::string_view(names, names_size);
+		arg.choice_set = static_cast<unsigned int>(this->_choice_sets.size());
+		this->_schema_changed();
+		this->_choice_sets.push_back(set);
+		size_t width = arg.arg_name.length() + arg.arg_choices.length() + 2 + 4 + 3;
+		if (_max_arg_name_len < width)
+			_max_arg_name_len = width;
+	}
+
+	// Hash and displace: names are spread over count buckets by their seed 0 hash,
+	// then, largest bucket first, each bucket gets the first displacement d whose
+	// seed d hashes send all of its names to free slots. Every slot ends up with
+	// exactly one name, so a lookup is two hashes and one compare.
+	void ArgumentParser::_hash_choices(ArgChoiceSet & set)
+	{
+		unsigned int count = set.count;
+		// scratch on the stack, spilling into the arena only for big sets
+		alignas(std::max_align_t) unsigned char stack[2048];
+		std::pmr::monotonic_buffer_resource scratch(stack, sizeof(stack), &this->_arena);
+		// names grouped by first-level bucket: bucket b is names[first[b], first[b + 1])
+		std::pmr::vector<unsigned int> first(static_cast<size_t>(count) + 1, 0, &scratch);
+		std::pmr::vector<unsigned int> names(count, 0, &scratch);
+		for (unsigned int i = 0; i < count; ++i)
+			++first[hash_range(hash_choice(this->_choices[set.first + i].name, 0, set.ignore_case), count) + 1];
+		for (unsigned int b = 0; b < count; ++b)
+			first[b + 1] += first[b];
+		std::pmr::vector<unsigned int> fill(first.begin(), first.end() - 1, &scratch);
+		for (unsigned int i = 0; i < count; ++i)
+			names[fill[hash_range(hash_choice(this->_choices[set.first + i].name, 0, set.ignore_case), count)]++] = i;
+		std::pmr::vector<unsigned int> order(count, 0, &scratch);
+		for (unsigned int i = 0; i < count; ++i)
+			order[i] = i;
+		// ties by bucket index: stable_sort's order, without its heap buffer
+		std::sort(order.begin(), order.end(), [&first](unsigned int a, unsigned int b) {
+			unsigned int size_a = first[a + 1] - first[a];
+			unsigned int size_b = first[b + 1] - first[b];
+			return size_a != size_b ? size_a > size_b : a < b;
+		});
+		this->_choice_table.resize(set.table + 2 * static_cast<size_t>(count), 0);
+		unsigned int * displacement = this->_choice_table.data() + set.table;
+		unsigned int * slots = displacement + count;
+		std::pmr::vector<bool> taken(count, false, &scratch);
+		std::pmr::vector<unsigned int> placed(&scratch);
+		placed.reserve(count);
+		for (auto it = order.begin(); it != order.end() && first[*it + 1] != first[*it]; ++it) {
+			const unsigned int * bucket = names.data() + first[*it];
+			size_t size = first[*it + 1] - first[*it];
+			for (unsigned int d = 1; ; ++d) {
+				if (d == 0x100000)
+					throw Error(CHOICE_ERROR, "Can't hash the choices");
+				placed.clear();
+				for (size_t name = 0; name < size; ++name) {
+					unsigned int slot = hash_range(hash_choice(this->_choices[set.first + bucket[name]].name, d, set.ignore_case), count);
+					if (taken[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end())
+						break;
+					placed.push_back(slot);
+				}
+				if (placed.size() != size)
+					continue;
+				for (size_t i = 0; i < size; ++i) {
+					taken[placed[i]] = true;
+					slots[placed[i]] = bucket[i];
+				}
+				displacement[*it] = d;
+				break;
+			}
+		}
+	}
+
+	// Index of name in set, -1 if it is not a choice
+	int ArgumentParser::_find_choice(const ArgChoiceSet & set, std::string_view name) const
+	{
+		const unsigned int * displacement = this->_choice_table.data() + set.table;
+		unsigned int bucket = hash_range(hash_choice(name, 0, set.ignore_case), set.count);
+		unsigned int slot = hash_range(hash_choice(name, displacement[bucket], set.ignore_case), set.count);
+		unsigned int index = displacement[set.count + slot];
+		return same_choice(this->_choices[set.first + index].name, name, set.ignore_case) ? static_cast<int>(index) : -1;
+	}
+
+	void ArgumentParser::set_short(std::string_view arg_name, char short_name)
+	{
+		int found = this->_find(arg_name);
+		if (found < 0 || this->_arguments[found].arg_imp != ArgImportance::iOptional)
+			throw Error(UNKNOWN_ARGUMENT_ERROR, "No optional argument '" + std::string(arg_name) + "'");
+		unsigned char c = static_cast<unsigned char>(short_name);
+		if (c >= 128 || !::isgraph(c) || c == '-' || c == '=' || c == this->_response_prefix)
+			throw Error(SHORT_OPTION_ERROR, "Invalid short name for '" + std::string(arg_name) + "'");
+		int taken = this->_find_short(short_name);
+		if (taken == found)
+			return;
+		if (taken >= 0 || this->_find(std::string_view(&short_name, 1)) >= 0)
+			throw Error(DUPLICATE_ARGUMENT_ERROR, "Short name '" + std::string(1, short_name) + "' is taken");
+		if (this->_arguments[found].arg_short)
+			this->_short_index[static_cast<unsigned char>(this->_arguments[found].arg_short)] = 0;
+		this->_arguments[found].arg_short = short_name;
+		this->_short_index[c] = static_cast<unsigned short>(found + 1);
+		this->_schema_changed();
+		// help prints "-c, " before the name
+		const ArgConfig & arg = this->_arguments[found];
+		size_t width = arg.arg_name.length() + metavar_size(arg, arg.arg_name.length()) + 4 + 3 + 4;
+		if (_max_arg_name_len < width)
+			_max_arg_name_len = width;
+	}
+
+	void ArgumentParser::set_env_prefix(std::string_view prefix)
+	{
+		this->_env_prefix.assign(prefix.data(), prefix.size());
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			if (it->arg_imp == ArgImportance::iOptional && it->arg_env.empty())
+				this->_set_env_name(*it);
+		}
+	}
+
+	void ArgumentParser::set_config_file(std::string_view path, bool required)
+	{
+		this->_config_path.assign(path.data(), path.size());
+		this->_config_required = required;
+	}
+
+	void ArgumentParser::set_config_key(std::string_view arg_name, std::string_view key)
+	{
+		int found = this->_find(arg_name);
+		if (found < 0 || this->_arguments[found].arg_imp != ArgImportance::iOptional)
+			throw Error(CONFIG_FILE_ERROR, "No optional argument '" + std::string(arg_name) + "'");
+		this->_arguments[found].arg_key = this->_intern(key);
+		this->_rebuild_key_index();
+	}
+
+	void ArgumentParser::_trie_insert(std::string_view name, unsigned int index)
+	{
+		if (this->_trie.empty())
+			this->_trie.emplace_back('\0', 0, ArgTrieNode::several);
+		unsigned int node = 0;
+		for (auto it = name.begin(); it != name.end(); ++it) {
+			unsigned int child = this->_trie[node].child;
+			while (child != 0 && this->_trie[child].label != *it)
+				child = this->_trie[child].sibling;
+			if (child == 0) {
+				child = static_cast<unsigned int>(this->_trie.size());
+				this->_trie.emplace_back(*it, this->_trie[node].child, index + 1);
+				this->_trie[node].child = child;
+			} else {
+				this->_trie[child].unique = ArgTrieNode::several;
+			}
+			node = child;
+		}
+		this->_trie[node].entry = index + 1;
+	}
+
+	// Trie node spelling prefix, -1 when no option name starts with it
+	int ArgumentParser::_trie_walk(std::string_view prefix) const
+	{
+		if (this->_trie.empty())
+			return -1;
+		unsigned int node = 0;
+		for (auto it = prefix.begin(); it != prefix.end(); ++it) {
+			unsigned int child = this->_trie[node].child;
+			while (child != 0 && this->_trie[child].label != *it)
+				child = this->_trie[child].sibling;
+			if (child == 0)
+				return -1;
+			node = child;
+		}
+		return static_cast<int>(node);
+	}
+
+	// The only optional whose name starts with prefix: -1 for none, -2 for several
+	int ArgumentParser::_find_abbreviation(std::string_view prefix) const
+	{
+		int node = this->_trie_walk(prefix);
+		if (node <= 0)
+			return -1;
+		unsigned int unique = this->_trie[node].unique;
+		return (unique == ArgTrieNode::several) ? -2 : static_cast<int>(unique - 1);
+	}
+
+	// Optional by name, or by abbreviation when enabled; -2 for an ambiguous one
+	int ArgumentParser::_find_option(std::string_view name) const
+	{
+		if (name.size() == 1) {
+			int found = this->_find_short(name.front());
+			if (found >= 0)
+				return found;
+		}
+		int found = this->_find(name);
+		if (found >= 0)
+			return (this->_arguments[found].arg_imp == ArgImportance::iOptional) ? found : -1;
+		return this->_abbreviations ? this->_find_abbreviation(name) : -1;
+	}
+
+	int ArgumentParser::_find_subcommand(std::string_view name) const
+	{
+		return index_find(this->_sub_index, name, [this](unsigned int i) { return this->_subcommands[i]->name; });
+	}
+
+	ArgumentParser::ArgumentParser(std::string_view description, std::string_view app_name, std::string_view author, std::pmr::memory_resource * upstream):
+		_arena(upstream),
+		_shared(&_arena),
+		exec_name(app_name, &_arena),
+		description(description, &_arena),
+		author(author, &_arena),
+		_config_path(&_arena),
+		_env_prefix(&_arena),
+		_arguments(&_arena),
+		_positionals(&_arena),
+		_arg_index(&_arena),
+		_bindings(&_arena),
+		_bind_struct(nullptr),
+		_subcommands(&_arena),
+		_sub_index(&_arena),
+		_trie(&_arena),
+		_key_index(&_arena),
+		_rules(&_arena),
+		_rule_masks(&_arena),
+		_choices(&_arena),
+		_choice_sets(&_arena),
+		_choice_table(&_arena),
+		_help(&_shared),
+		_result(&_arena)
+	{
+		this->_init();
+	}
+
+	ArgumentParser::ArgumentParser():
+		ArgumentParser(std::pmr::get_default_resource())
+	{
+	}
+
+	ArgumentParser::ArgumentParser(std::pmr::memory_resource * upstream):
+		ArgumentParser(std::string_view(), std::string_view(), std::string_view(), upstream)
+	{
+	}
+
+	ArgumentParser::ArgumentParser(std::string_view description, std::string_view app_name, std::string_view author, void * buffer, size_t size):
+		_arena(buffer, size, std::pmr::null_memory_resource()),
+		_shared(&_arena),
+		exec_name(app_name, &_arena),
+		description(description, &_arena),
+		author(author, &_arena),
+		_config_path(&_arena),
+		_env_prefix(&_arena),
+		_arguments(&_arena),
+		_positionals(&_arena),
+		_arg_index(&_arena),
+		_bindings(&_arena),
+		_bind_struct(nullptr),
+		_subcommands(&_arena),
+		_sub_index(&_arena),
+		_trie(&_arena),
+		_key_index(&_arena),
+		_rules(&_arena),
+		_rule_masks(&_arena),
+		_choices(&_arena),
+		_choice_sets(&_arena),
+		_choice_table(&_arena),
+		_help(&_shared),
+		_result(&_arena)
+	{
+		this->_init();
+	}
+
+	ArgumentParser::ArgumentParser(void * buffer, size_t size):
+		ArgumentParser(std::string_view(), std::string_view(), std::string_view(), buffer, size)
+	{
+	}
+
+	std::string_view ArgumentParser::_intern(std::string_view str)
+	{
+		if (str.empty())
+			return std::string_view();
+		// NUL-terminated, so environment variable names can go to getenv()
+		char * copy = static_cast<char *>(this->_arena.allocate(str.size() + 1, 1));
+		std::memcpy(copy, str.data(), str.size());
+		copy[str.size()] = '\0';
+		return std::string_view(copy, str.size());
+	}
+
+	ArgumentParser::~ArgumentParser()
+	{
+		// subcommands live in the arena, which only frees memory
+		for (auto it = this->_subcommands.begin(); it != this->_subcommands.end(); ++it)
+			(*it)->~Subcommand();
+	}
+
+	void ArgumentParser::add_subcommand(std::string_view name, std::string_view help, std::function<void(ArgumentParser &)> factory)
+	{
+		if (this->_find_subcommand(name) >= 0)
+			throw Error(DUPLICATE_ARGUMENT_ERROR, "");
+		void * memory = this->_arena.allocate(sizeof(Subcommand), alignof(Subcommand));
+		Subcommand * sub = new (memory) Subcommand(this->_intern(name), this->_intern(help), std::move(factory));
+		this->_subcommands.push_back(sub);
+		index_insert(this->_sub_index, static_cast<unsigned int>(this->_subcommands.size() - 1),
+			[this](unsigned int i) { return this->_subcommands[i]->name; });
+		this->_schema_changed();
+		if (_max_arg_name_len < name.length() + 4 + 3)
+			_max_arg_name_len = name.length() + 4 + 3;
+	}
+
+	const ArgumentParser & ArgumentParser::_subparser(Subcommand & sub) const
+	{
+		// parses may run concurrently (parse_batch), the factory runs once
+		std::call_once(sub.built, [&]() {
+			// on the parent's arena, which the subparser's own arena grows from
+			void * memory = this->_shared.allocate(sizeof(ArgumentParser), alignof(ArgumentParser));
+			ArgumentParser * parser = new (memory) ArgumentParser(sub.help, sub.name, this->author, &this->_shared);
+			try {
+				sub.factory(*parser);
+			} catch (...) {
+				parser->~ArgumentParser();
+				throw;
+			}
+			sub.parser = parser;
+		});
+		return *sub.parser;
+	}
+
+	bool ArgumentParser::parse_check_complete(int argc, char * argv[]) const
+	{
+		if (argc < 2 || std::string_view(argv[1]) != "--__complete")
+			return false;
+		std::vector<std::string_view> words(argv + 2, argv + argc);
+		std::string out;
+		this->_complete(words.data(), words.size(), out);
+		std::fwrite(out.data(), 1, out.size(), stdout);
+		std::fflush(stdout);
+		return true;
+	}
+
+	void ArgumentParser::complete(const std::vector<std::string_view> & words, std::string & out) const
+	{
+		this->_complete(words.data(), words.size(), out);
+	}
+
+	void ArgumentParser::_complete(const std::string_view * words, size_t count, std::string & out) const
+	{
+		std::string_view partial = count ? words[count - 1] : std::string_view();
+		// skip over the complete words: option values, and find a subcommand
+		bool value_next = false;
+		for (size_t i = 0; i + 1 < count; ++i) {
+			std::string_view word = words[i];
+			if (value_next) {
+				value_next = false;
+				continue;
+			}
+			if (is_option_token(word)) {
+				if (optional_split(word) != std::string_view::npos)
+					continue;
+				word.remove_prefix(std::min(word.find_first_not_of('-'), word.size()));
+				int found = this->_find_option(word);
+				value_next = found >= 0 && this->_arguments[found].arg_nargs == ArgNargs::nOne
+					&& this->_arguments[found].arg_type != ArgType::tStoreTrue
+					&& this->_arguments[found].arg_type != ArgType::tStoreFalse
+					&& this->_arguments[found].arg_type != ArgType::tCount;
+				continue;
+			}
+			int sub = this->_subcommands.empty() ? -1 : this->_find_subcommand(word);
+			if (sub >= 0) {
+				this->_subparser(*this->_subcommands[sub])._complete(words + i + 1, count - i - 1, out);
+				return;
+			}
+		}
+		// a value is expected, there is nothing to offer
+		if (value_next)
+			return;
+		size_t dashes = std::min(partial.find_first_not_of('-'), partial.size());
+		if (dashes <= 2 && this->_trie_walk(partial.substr(dashes)) >= 0) {
+			std::string_view prefix = dashes ? partial.substr(0, dashes) : std::string_view("--");
+			// depth-first over the subtree of the partial name
+			std::vector<unsigned int> stack(1, static_cast<unsigned int>(this->_trie_walk(partial.substr(dashes))));
+			while (!stack.empty()) {
+				const ArgTrieNode & node = this->_trie[stack.back()];
+				stack.pop_back();
+				if (node.entry) {
+					out.append(prefix.data(), prefix.size());
+					out.append(this->_arguments[node.entry - 1].arg_name.data(), this->_arguments[node.entry - 1].arg_name.size());
+					out += '\n';
+				}
+				for (unsigned int child = node.child; child != 0; child = this->_trie[child].sibling)
+					stack.push_back(child);
+			}
+		}
+		if (dashes != 0)
+			return;
+		for (auto it = this->_subcommands.begin(); it != this->_subcommands.end(); ++it) {
+			if ((*it)->name.substr(0, partial.size()) == partial) {
+				out.append((*it)->name.data(), (*it)->name.size());
+				out += '\n';
+			}
+		}
+	}
+
+	const ArgumentParser * ArgumentParser::get_subcommand(std::string_view name) const
+	{
+		int found = this->_find_subcommand(name);
+		if (found < 0)
+			return nullptr;
+		return &this->_subparser(*this->_subcommands[found]);
+	}
+
+	bool ArgumentParser::parse_check_help(int argc, char * argv[]) const {
+		const std::string_view help[2] = {"--help", "/?"};
+		for (int i = 0; i < argc; ++i) {
+			std::string_view temp(argv[i]);
+			for (int j = 0; j < 2; ++j) {
+				if (temp == help[j])
+					return true;
+			}
+		}
+		return false;
+	}
+
+	void ArgumentParser::add_argument(std::string_view arg_name, std::string_view arg_help, ArgType arg_type, ArgImportance arg_imp, ArgSpecialBehavior arg_sb)
+	{
+		if (this->_find(arg_name) >= 0 || (arg_name.size() == 1 && this->_find_short(arg_name.front()) >= 0))
+			throw Error(DUPLICATE_ARGUMENT_ERROR, "");
+		if (arg_type == ArgType::tChoice)
+			throw Error(CHOICE_ERROR, "Choices of '" + std::string(arg_name) + "' are given with add_choices()");
+		arg_name = this->_intern(arg_name);
+		arg_help = this->_intern(arg_help);
+		if (arg_imp == ArgImportance::iPositional) {
+			if (this->_positional_open)
+				throw Error(NARGS_ERROR, "Positional argument '" + std::string(arg_name) + "' follows a positional with a variable count");
+			++this->positional_count;
+			this->_positionals.push_back(static_cast<unsigned int>(this->_arguments.size()));
+			this->_arguments.emplace_back(arg_name, arg_help, arg_type, arg_imp, arg_sb, static_cast<int>(this->_positional_min) + 1);
+		}
+		if (arg_imp == ArgImportance::iOptional) {
+			++this->optional_count;
+			this->_arguments.emplace_back(arg_name, arg_help, arg_type, arg_imp, arg_sb, -1);
+		}
+		this->_index_insert(static_cast<unsigned int>(this->_arguments.size() - 1));
+		this->arguments_count++;
+		if (arg_imp == ArgImportance::iPositional)
+			++this->_positional_min;
+		if (_max_arg_name_len < (arg_name.length() * 2) + 4 + 3)
+			_max_arg_name_len = (arg_name.length() * 2) + 4 + 3;
+	}
+
+	void ArgumentParser::_bind(std::string_view arg_name, std::string_view arg_help, ArgImportance arg_imp, ArgBinding binding)
+	{
+		this->add_argument(arg_name, arg_help, binding.type, arg_imp);
+		binding.index = static_cast<unsigned int>(this->_arguments.size() - 1);
+		this->_bindings.push_back(binding);
+	}
+
+	void ArgumentParser::_bind_struct_type(const std::type_info & type)
+	{
+		if (this->_bind_struct && *this->_bind_struct != type)
+			throw Error(BIND_ERROR, "Arguments are bound to members of different structs");
+		this->_bind_struct = &type;
+	}
+
+	void ArgumentParser::_check_struct_type(const std::type_info & type) const
+	{
+		if (!this->_bind_struct || *this->_bind_struct != type)
+			throw Error(BIND_ERROR, std::string("No arguments are bound to members of ") + type.name());
+	}
+
+	void ArgumentParser::add_argument(std::string_view arg_name, std::string_view arg_help, ArgType arg_type, ArgImportance arg_imp, ArgNargs nargs, unsigned int count)
+	{
+		if (this->_find(arg_name) >= 0 || (arg_name.size() == 1 && this->_find_short(arg_name.front()) >= 0))
+			throw Error(DUPLICATE_ARGUMENT_ERROR, "");
+		if (arg_type == ArgType::tStoreTrue || arg_type == ArgType::tStoreFalse || arg_type == ArgType::tCount)
+			throw Error(NARGS_ERROR, "Flag '" + std::string(arg_name) + "' can't take values");
+		if (arg_type == ArgType::tChoice)
+			throw Error(CHOICE_ERROR, "Choices of '" + std::string(arg_name) + "' are given with add_choices()");
+		if (nargs == ArgNargs::nExactly && count == 0)
+			throw Error(NARGS_ERROR, "Argument '" + std::string(arg_name) + "' needs a value count");
+		if (arg_imp == ArgImportance::iPositional && this->_positional_open)
+			throw Error(NARGS_ERROR, "Positional argument '" + std::string(arg_name) + "' follows a positional with a variable count");
+		arg_name = this->_intern(arg_name);
+		arg_help = this->_intern(arg_help);
+		if (nargs != ArgNargs::nExactly)
+			count = 1;
+		ArgConfig arg(arg_name, arg_help, arg_type, arg_imp, ArgSpecialBehavior::None, -1, nargs, count);
+		if (arg_imp == ArgImportance::iPositional) {
+			arg.pos = static_cast<int>(this->_positional_min) + 1;
+			this->_positional_min += arg.nargs_min;
+			this->_positional_open = arg.nargs_min != arg.nargs_max;
+			++this->positional_count;
+			this->_positionals.push_back(static_cast<unsigned int>(this->_arguments.size()));
+		} else {
+			++this->optional_count;
+		}
+		this->_arguments.push_back(std::move(arg));
+		this->_index_insert(static_cast<unsigned int>(this->_arguments.size() - 1));
+		this->arguments_count++;
+		const ArgConfig & added = this->_arguments.back();
+		size_t width = added.arg_name.length() + metavar_size(added, added.arg_name.length()) + 4 + 3;
+		if (_max_arg_name_len < width)
+			_max_arg_name_len = width;
+	}
+
+	Error ArgumentParser::parse_args(int argc, char * argv[]) {
+		// before parsing, so the usage printed for a parse error already has it
+		if (argc > 0 && argv[0]) {
+			std::string_view name = this->_parse_exec_name(argv[0]);
+			if (name != std::string_view(this->exec_name)) {
+				this->exec_name.assign(name.data(), name.size());
+				this->_schema_changed();
+			}
+		}
+		this->parse_args(argc, argv, this->_result);
+		return Error();
+	}
+
+	template <typename Iterator>
+	ParseError ArgumentParser::_try_parse(Iterator first, Iterator last, ParseResult & result, void * object) const
+	{
+		ARGPARSE_PARSE_TIMER(result);
+		result.reset();
+		this->_start(result);
+		Tokenizer state(result);
+		state.object = object;
+		Iterator it = first;
+		if (it != last) {
+			ARGPARSE_PHASE(result, pExecName);
+			result.exec_name = this->_parse_exec_name(*it);
+			++it;
+		}
+		// one pass over argv, tokens go straight to the tokenizer
+		int subcommand = -1;
+		{
+			ARGPARSE_PHASE(result, pTokenize);
+			for (; it != last; ++it) {
+				state.argv_index = static_cast<int>(it - first);
+				if (!this->_subcommands.empty() && this->_at_subcommand(*it, state)) {
+					subcommand = this->_find_subcommand(*it);
+					if (subcommand < 0)
+						return ParseError(SUBCOMMAND_ERROR, state.argv_index, *it, nullptr);
+					break;
+				}
+				if (!this->_push_argument(*it, state, 0))
+					break;
+			}
+		}
+		ParseError error = this->_finish(state);
+		if (subcommand < 0 || error.code != NO_ERROR)
+			return error;
+		// the subcommand parses the rest of argv into the nested result
+		result._subcommand = this->_subcommands[subcommand]->name;
+		error = this->_subparser(*this->_subcommands[subcommand])._try_parse(it, last, result._nested(), nullptr);
+		// -1 (a source or a missing value) isn't an argv position and stays as it is
+		if (error.code != NO_ERROR && error.argv_index >= 0)
+			error.argv_index += state.argv_index;
+		return error;
+	}
+
+	ParseOutcome ArgumentParser::try_parse(int argc, char * argv[], ParseResult & result) const {
+		return ParseOutcome(result, this->_try_parse(argv, argv + argc, result, nullptr));
+	}
+
+	ParseOutcome ArgumentParser::try_parse(const std::vector<std::string_view> & args, ParseResult & result) const {
+		return ParseOutcome(result, this->_try_parse(args.begin(), args.end(), result, nullptr));
+	}
+
+	ParseOutcome ArgumentParser::try_parse_command_line(std::string_view line, ParseResult & result) const {
+		size_t quote = split_command_line(line, result._line, result._line_words);
+		if (quote != std::string_view::npos) {
+			result.reset();
+			return ParseOutcome(result, ParseError(COMMAND_LINE_ERROR, -1, line.substr(quote), nullptr));
+		}
+		return ParseOutcome(result, this->_try_parse(result._line_words.cbegin(), result._line_words.cend(), result, nullptr));
+	}
+
+	void ArgumentParser::parse_command_line(std::string_view line, ParseResult & result) const {
+		ParseOutcome outcome = this->try_parse_command_line(line, result);
+		if (!outcome)
+			throw Error(outcome.error().code, outcome.error().message());
+	}
+
+	ParseOutcome ArgumentParser::_try_parse_into(int argc, char * argv[], ParseResult & result, void * object) const {
+		return ParseOutcome(result, this->_try_parse(argv, argv + argc, result, object));
+	}
+
+	void ArgumentParser::parse_args(int argc, char * argv[], ParseResult & result) const {
+		ParseError error = this->_try_parse(argv, argv + argc, result, nullptr);
+		if (error.code != NO_ERROR)
+			throw Error(error.code, error.message());
+	}
+
+	void ArgumentParser::parse_args(const std::vector<std::string_view> & args, ParseResult & result) const {
+		ParseError error = this->_try_parse(args.begin(), args.end(), result, nullptr);
+		if (error.code != NO_ERROR)
+			throw Error(error.code, error.message());
+	}
+
+	bool ArgumentParser::_push_argument(std::string_view token, Tokenizer & state, int depth) const
+	{
+		if (this->_response_format != ResponseFileFormat::fNone && token.size() > 1 && token.front() == this->_response_prefix)
+			return this->_expand_response_file(token.substr(1), state, depth + 1);
+		return this->_tokenize(token, state);
+	}
+
+	bool ArgumentParser::_expand_response_file(std::string_view path, Tokenizer & state, int depth) const
+	{
+		if (depth > max_response_file_depth) {
+			state.error = ParseError(RESPONSE_FILE_DEPTH_ERROR, state.argv_index, path, nullptr);
+			return false;
+		}
+		MappedFile file;
+		if (!file.open(std::string(path))) {
+			state.error = ParseError(RESPONSE_FILE_ERROR, state.argv_index, path, nullptr);
+			return false;
+		}
+		// the mapping doesn't move with the MappedFile, views stay valid
+		std::string_view data = file.view();
+		state.result._files.push_back(std::move(file));
+
+		char delimiter = '\n';
+		if (this->_response_format == ResponseFileFormat::fNul)
+			delimiter = '\0';
+		if (this->_response_format == ResponseFileFormat::fAuto && data.find('\0') != std::string_view::npos)
+			delimiter = '\0';
+		size_t begin = 0;
+		while (begin < data.size()) {
+			size_t end = data.find(delimiter, begin);
+			if (end == std::string_view::npos)
+				end = data.size();
+			std::string_view token = data.substr(begin, end - begin);
+			if (delimiter == '\n' && !token.empty() && token.back() == '\r')
+				token.remove_suffix(1);
+			if (!token.empty() && !this->_push_argument(token, state, depth))
+				return false;
+			begin = end + 1;
+		}
+		return true;
+	}
+
+	void ArgumentParser::parse_batch(const std::vector<std::vector<std::string_view>> & command_lines, std::vector<ParseResult> & results, unsigned int workers) const
+	{
+		size_t count = command_lines.size();
+		results.resize(count);
+		if (workers == 0)
+			workers = std::max(1u, std::thread::hardware_concurrency());
+		// chunked scheduling: workers grab the next chunk of indices from a shared counter
+		size_t chunk = std::max<size_t>(1, count / (static_cast<size_t>(workers) * 8));
+		size_t chunks = (count + chunk - 1) / chunk;
+		if (workers > chunks)
+			workers = static_cast<unsigned int>(std::max<size_t>(1, chunks));
+
+		std::atomic<size_t> next(0);
+		std::exception_ptr failure;
+		std::mutex failure_lock;
+		auto work = [&]() {
+			try {
+				for (;;) {
+					size_t first = next.fetch_add(chunk);
+					if (first >= count)
+						return;
+					size_t last = std::min(count, first + chunk);
+					for (size_t i = first; i < last; ++i) {
+						ParseError error = this->_try_parse(command_lines[i].begin(), command_lines[i].end(), results[i], nullptr);
+						if (error.code != NO_ERROR)
+							results[i]._error = Error(error.code, error.message());
+					}
+				}
+			}
+			catch (...) {
+				// not a parse error (e.g. bad_alloc): stop this worker, rethrow after join
+				std::lock_guard<std::mutex> guard(failure_lock);
+				if (!failure)
+					failure = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(workers - 1);
+		for (unsigned int i = 1; i < workers; ++i) {
+			try {
+				threads.emplace_back(work);
+			}
+			catch (...) {
+				// no more threads (std::system_error): the started ones and this one
+				// share all chunks anyway, and must be joined before leaving
+				break;
+			}
+		}
+		work();
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+			it->join();
+		if (failure)
+			std::rethrow_exception(failure);
+	}
+
+	bool ArgumentParser::is_optional(std::string_view str)
+	{
+		return optional_split(str) != std::string_view::npos;
+	}
+
+	bool ArgumentParser::is_negative_number(std::string_view str)
+	{
+		if (str.size() < 2 || str[0] != '-')
+			return false;
+		if (is_digit(str[1]))
+			return true;
+		return str.size() > 2 && str[1] == '.' && is_digit(str[2]);
+	}
+
+	ArgConfig::ArgConfig(
+		std::string_view arg_name,
+		std::string_view arg_help,
+		ArgType arg_type,
+		ArgImportance arg_imp,
+		ArgSpecialBehavior arg_sb,
+		int pos,
+		ArgNargs arg_nargs,
+		unsigned int nargs_count
+	):
+		arg_name(arg_name),
+		arg_help(arg_help),
+		arg_type(arg_type),
+		arg_imp(arg_imp),
+		arg_sb(arg_sb),
+		pos(pos),
+		arg_nargs(arg_nargs),
+		nargs_min(1),
+		nargs_max(1),
+		arg_short('\0'),
+		choice_set(0)
+	{
+		switch (arg_nargs) {
+		case ArgNargs::nOne:
+			break;
+		case ArgNargs::nOptional:
+			this->nargs_min = 0;
+			break;
+		case ArgNargs::nZeroOrMore:
+			this->nargs_min = 0;
+			this->nargs_max = std::numeric_limits<unsigned int>::max();
+			break;
+		case ArgNargs::nOneOrMore:
+			this->nargs_max = std::numeric_limits<unsigned int>::max();
+			break;
+		case ArgNargs::nExactly:
+			this->nargs_min = nargs_count;
+			this->nargs_max = nargs_count;
+			break;
+		}
+	}
+
+	ArgConfig::ArgConfig():
+		arg_nargs(ArgNargs::nOne),
+		nargs_min(1),
+		nargs_max(1),
+		arg_short('\0'),
+		choice_set(0)
+	{
+	}
+
+	ArgSlot::ArgSlot():
+		arg_set(false),
+		arg_sourced(false),
+		arg_str_value(),
+		arg_value(),
+		arg_converted(false),
+		arg_token(0),
+		list_offset(0),
+		list_size(0)
+	{
+	}
+
+	ParseResult::ParseResult():
+		ParseResult(std::pmr::get_default_resource())
+	{
+	}
+
+	ParseResult::ParseResult(std::pmr::memory_resource * resource):
+		_parser(nullptr),
+		sanitized_arguments(resource),
+		_token_argv(resource),
+		_slots(resource),
+		_files(resource),
+		_int_list(resource),
+		_int64_list(resource),
+		_uint64_list(resource),
+		_float_list(resource),
+		_double_list(resource),
+		_drop_positional(false),
+		_help(false),
+		_sub_result(nullptr, ParseResultDeleter{ resource }),
+		_stats(nullptr),
+		_line(resource),
+		_line_words(resource),
+		_present(resource)
+	{
+	}
+
+	void ParseResult::reset()
+	{
+		this->sanitized_arguments.clear();
+		this->_token_argv.clear();
+		this->_files.clear();
+		this->_int_list.clear();
+		this->_int64_list.clear();
+		this->_uint64_list.clear();
+		this->_float_list.clear();
+		this->_double_list.clear();
+		std::fill(this->_slots.begin(), this->_slots.end(), ArgSlot());
+		this->exec_name = std::string_view();
+		this->_drop_positional = false;
+		this->_help = false;
+		this->_error = Error();
+		this->_subcommand = std::string_view();
+	}
+
+	ParseResult & ParseResult::_nested()
 	{
-		_max_arg_name_len = 0;
-		this->_argc = 1;
-		this->arguments_count = 0;
-		this->positional_count = 0;
-		this->optional_count = 0;
-		#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-		os_sep = '\\';
+		if (!this->_sub_result) {
+			std::pmr::memory_resource * resource = this->_sub_result.get_deleter().resource;
+			void * memory = resource->allocate(sizeof(ParseResult), alignof(ParseResult));
+			this->_sub_result.reset(new (memory) ParseResult(resource));
+		}
+		return *this->_sub_result;
+	}
+
+	void ParseResultDeleter::operator()(ParseResult * result) const
+	{
+		result->~ParseResult();
+		this->resource->deallocate(result, sizeof(ParseResult), alignof(ParseResult));
+	}
+
+	const ArgSlot * ParseResult::_find_value(std::string_view name, ArgType type) const
+	{
+		int index = this->_parser ? this->_parser->_find(name) : -1;
+		if (index < 0 || !this->_slots[index].arg_set)
+			return nullptr;
+		// counts are read as int, choices as int or as the given string
+		ArgType arg_type = this->_parser->_arguments[index].arg_type;
+		bool as_int = (arg_type == ArgType::tCount || arg_type == ArgType::tChoice) && type == ArgType::tInt;
+		if (arg_type != type && !as_int && !(arg_type == ArgType::tChoice && type == ArgType::tString))
+			return nullptr;
+		if (this->_parser->_arguments[index].is_list())
+			return nullptr;
+		return this->_converted(index);
+	}
+
+	const ArgSlot * ParseResult::_find_list(std::string_view name, ArgType type) const
+	{
+		int index = this->_parser ? this->_parser->_find(name) : -1;
+		if (index < 0 || this->_parser->_arguments[index].arg_type != type || !this->_slots[index].arg_set)
+			return nullptr;
+		if (!this->_parser->_arguments[index].is_list())
+			return nullptr;
+		return this->_converted(index);
+	}
+
+	const ArgSlot * ParseResult::_converted(int index) const
+	{
+		if (!this->_slots[index].arg_converted) {
+			ParseError error = this->_parser->_convert_argument(*this, static_cast<size_t>(index));
+			if (error.code != NO_ERROR)
+				throw Error(error.code, error.message());
+		}
+		return &this->_slots[index];
+	}
+
+	void ParseResult::validate_all() const
+	{
+		ParseError error = this->try_validate_all();
+		if (error.code != NO_ERROR)
+			throw Error(error.code, error.message());
+	}
+
+	ParseError ParseResult::try_validate_all() const
+	{
+		if (!this->_parser)
+			return ParseError();
+		return this->_parser->_convert_arguments(*this);
+	}
+
+	const ArgSlot * ParseResult::_find_flag(std::string_view name) const
+	{
+		int index = this->_parser ? this->_parser->_find(name) : -1;
+		if (index < 0)
+			return nullptr;
+		ArgType type = this->_parser->_arguments[index].arg_type;
+		if (type != ArgType::tStoreTrue && type != ArgType::tStoreFalse)
+			return nullptr;
+		return this->_converted(index);
+	}
+
+	MappedFile::MappedFile():
+		_data(nullptr),
+		_size(0),
+		_mapping(nullptr)
+	{
+	}
+
+	MappedFile::MappedFile(MappedFile && other) noexcept:
+		_data(other._data),
+		_size(other._size),
+		_mapping(other._mapping),
+		_buffer(std::move(other._buffer))
+	{
+		other._data = nullptr;
+		other._size = 0;
+		other._mapping = nullptr;
+	}
+
+	MappedFile & MappedFile::operator=(MappedFile && other) noexcept
+	{
+		if (this != &other) {
+			this->close();
+			std::swap(this->_data, other._data);
+			std::swap(this->_size, other._size);
+			std::swap(this->_mapping, other._mapping);
+			std::swap(this->_buffer, other._buffer);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		this->close();
+	}
+
+	bool MappedFile::open(const char * path)
+	{
+		this->close();
+		#if defined(_WIN32)
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		bool loaded = this->_load(reinterpret_cast<std::intptr_t>(file));
+		CloseHandle(file);
 		#else
-		os_sep = '/';
+		int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+		bool loaded = this->_load(fd);
+		::close(fd);
 		#endif
-		exec_name += ".exe";
-		std::regex re_optional_argument("^-{1,2}([a-zA-z0-9]-{0,1}){0,}[a-zA-z0-9]+=(('[\\w\\W]+')|(\"[\\w\\W]+\")|([\\w\\W]+))$");
-		this->re_optional_argument = re_optional_argument;
-		std::regex re_float("^(([0-9]+)|([0-9]+.[0-9]+))$");
-		this->re_float = re_float;
-		std::regex re_int("^[0-9]+$");
-		this->re_int = re_int;
+		return loaded;
 	}
 
-	void ArgumentParser::_parse_exec_name()
+	bool MappedFile::open_fd(int fd)
 	{
-		std::string temp = this->raw_arguments[0];
-		while (temp.find(this->os_sep) != std::string::npos)
-			temp.erase(0, temp.find(this->os_sep) + 1);
-		this->exec_name = temp;
+		this->close();
+		#if defined(_WIN32)
+		std::intptr_t file = _get_osfhandle(fd);
+		if (file == -1)
+			return false;
+		return this->_load(file);
+		#else
+		return this->_load(fd);
+		#endif
 	}
 
-	void ArgumentParser::_parse_positional()
+	bool MappedFile::_load(std::intptr_t file)
 	{
-		if (this->positional_count == 0)
-			return;
-		if (this->positional_count > this->sanitized_arguments.size())
-			throw Error(POSITIONAL_ERROR, "Not enough positional arguments provided");
-		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
-			if (it->second.arg_imp != ArgImportance::iPositional)
-				continue;
-			int loc_pos = it->second.pos - 1; // -1 -> no executable path in sanitized_arguments
-			size_t loc_size = this->sanitized_arguments.size() - 1;
-			if ((loc_pos > loc_size) | (loc_pos < 0))
-				continue;
-			if (this->sanitized_arguments[loc_pos].find('-') == 0) {
-				std::ostringstream err_msg;
-				err_msg << "Positional argument can't start with '-' character" << std::endl;
-				err_msg << "Error while parsing positional argument: " << it->second.arg_name;
-				throw Error(POSITIONAL_ERROR, err_msg.str().c_str());
-			}
-			it->second.arg_str_value = this->sanitized_arguments[loc_pos];
-			it->second.arg_set = true;
-		}
-	}
-
-	void ArgumentParser::_parse_optional()
-	{
-		if (this->optional_count == 0) return;
-		for (auto it = this->sanitized_arguments.begin(); it != this->sanitized_arguments.end(); ++it) {
-			std::string temp = *it;
-			if (temp.find('-') != 0) continue;
-			while (temp.find('-') == 0) temp.erase(0, 1);
-			// check map
-			if (this->_arguments.count(temp) == 1) {
-				if (this->_arguments[temp].arg_sb == ArgSpecialBehavior::DROP_POSITIONAL_CHECK)
-					this->_drop_positional = true;
-				// Optional types WITHOUT value
-				if (this->_arguments[temp].arg_type == ArgType::tStoreTrue) {
-					this->_arguments[temp].arg_str_value = "<store_true>";
-					this->_arguments[temp].arg_set = true;
-					continue;
+		#if defined(_WIN32)
+		HANDLE handle = reinterpret_cast<HANDLE>(file);
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(handle, &size))
+			return false;
+		if (size.QuadPart == 0)
+			return true;
+		HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+			return false;
+		void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) {
+			CloseHandle(mapping);
+			return false;
+		}
+		this->_mapping = mapping;
+		this->_data = static_cast<const char *>(data);
+		this->_size = static_cast<size_t>(size.QuadPart);
+		#else
+		int fd = static_cast<int>(file);
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+			return false;
+		if (!S_ISREG(st.st_mode)) {
+			// pipes and process substitution can't be mapped, read them instead
+			size_t capacity = 4096;
+			std::unique_ptr<char[]> buffer(new char[capacity]);
+			size_t size = 0;
+			for (;;) {
+				if (size == capacity) {
+					std::unique_ptr<char[]> grown(new char[capacity * 2]);
+					std::memcpy(grown.get(), buffer.get(), size);
+					buffer = std::move(grown);
+					capacity *= 2;
 				}
-				if (this->_arguments[temp].arg_type == ArgType::tStoreFalse) {
-					this->_arguments[temp].arg_str_value = "<store_false>";
-					this->_arguments[temp].arg_set = true;
+				ssize_t n = ::read(fd, buffer.get() + size, capacity - size);
+				if (n < 0 && errno == EINTR)
 					continue;
-				}
-				// Optional types WITH value
-				if (it + 1 != this->sanitized_arguments.end()) {
-					this->_arguments[temp].arg_set = true;
-					this->_arguments[temp].arg_str_value = *(it + 1);
-				} else {
-					std::string error_msg = "[argparse] Optional parameter '"+ temp +"' provided with no value";
-					throw Error(OPTIONAL_PROVIDED_WITH_NO_VALUE, error_msg.c_str());
-				}
-			} else {
-				continue;
+				if (n < 0)
+					return false;
+				if (n == 0)
+					break;
+				size += static_cast<size_t>(n);
 			}
+			this->_buffer = std::move(buffer);
+			this->_data = this->_buffer.get();
+			this->_size = size;
+			return true;
 		}
+		if (st.st_size == 0)
+			return true;
+		void * data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+			return false;
+		this->_data = static_cast<const char *>(data);
+		this->_size = static_cast<size_t>(st.st_size);
+		#endif
+		return true;
 	}
 
-	void ArgumentParser::_sanitize_arguments_vector()
+	void MappedFile::close()
 	{
-		// alloc memory
-		unsigned short to_alloc = 2 * this->optional_count + this->positional_count;
-		this->sanitized_arguments.reserve(to_alloc);
-		// split optional arguments with '=' character
-		for (auto it = this->raw_arguments.begin() + 1; it != this->raw_arguments.end(); ++it) {
-			if (this->is_optional(*it)) {
-				auto ch = it->find('=');
-				this->sanitized_arguments.push_back(it->substr(0, ch));
-				this->sanitized_arguments.push_back(it->substr(ch + 1, it->length() - 1));
-			} else {
-				this->sanitized_arguments.push_back(*it);
-			}
-		}
-		// trim ' character
-		for (auto it = this->sanitized_arguments.begin(); it != this->sanitized_arguments.end(); ++it) {
-			if (it->find_first_of('\'') == 0 && it->find_last_of('\'') == it->length()-1) {
-				it->erase(0, 1);
-				it->erase(it->length() - 1, 1);
-			}
+		if (this->_buffer) {
+			this->_buffer.reset();
+		} else if (this->_size != 0) {
+			#if defined(_WIN32)
+			UnmapViewOfFile(this->_data);
+			CloseHandle(this->_mapping);
+			#else
+			munmap(const_cast<char *>(this->_data), this->_size);
+			#endif
 		}
+		this->_data = nullptr;
+		this->_size = 0;
+		this->_mapping = nullptr;
 	}
 
-	void ArgumentParser::_convert_arguments()
+	ParseError::ParseError():
+		code(NO_ERROR),
+		argv_index(-1),
+		token(),
+		arg(nullptr),
+		other(nullptr)
 	{
-		auto get_err_msg = [](ArgConfig obj)->std::string {
-			std::string ret = "Can't convert argument '" + obj.arg_name + "' to ";
-			if (obj.arg_type == ArgType::tInt)
-				ret += "int";
-			if (obj.arg_type == ArgType::tFloat)
-				ret += "float";
-			if (obj.arg_type == ArgType::tDouble)
-				ret += "double";
-			ret += " | provided value: " + obj.arg_str_value;
-			return ret;
-		};
+	}
 
-		for (auto it = _arguments.begin(); it != _arguments.end(); ++it) {
-			if (it->second.arg_set) {
-				// String
-				if (it->second.arg_type == ArgType::tString) {
-					_arg_map_string[it->first] = it->second.arg_str_value;
-					continue;
-				}
-				// Integer
-				if (it->second.arg_type == ArgType::tInt) {
-					std::cmatch m;
-					if (!std::regex_match(it->second.arg_str_value.c_str(), m, re_int))
-						throw Error(CONVERT_ARG_ERROR, get_err_msg(it->second).c_str());
-					std::istringstream iss(it->second.arg_str_value);
-					int temp;
-					iss >> temp;
-					_arg_map_int[it->first] = temp;
-					continue;
-				}
-				// Float
-				if (it->second.arg_type == ArgType::tFloat) {
-					std::cmatch m;
-					if (!std::regex_match(it->second.arg_str_value.c_str(), m, re_float))
-						throw Error(CONVERT_ARG_ERROR, get_err_msg(it->second).c_str());
-					std::istringstream iss(it->second.arg_str_value);
-					float temp;
-					iss >> temp;
-					_arg_map_float[it->first] = temp;
-					continue;
-				}
-				// Double
-				if (it->second.arg_type == ArgType::tDouble) {
-					std::cmatch m;
-					if (!std::regex_match(it->second.arg_str_value.c_str(), m, re_float))
-						throw Error(CONVERT_ARG_ERROR, get_err_msg(it->second).c_str());
-					std::istringstream iss(it->second.arg_str_value);
-					double temp;
-					iss >> temp;
-					_arg_map_double[it->first] = temp;
-					continue;
-				}
-				// Store True (set)
-				if (it->second.arg_type == ArgType::tStoreTrue) {
-					_arg_map_bool[it->first] = true;
-					continue;
-				}
-				// Store False (set)
-				if (it->second.arg_type == ArgType::tStoreFalse) {
-					_arg_map_bool[it->first] = false;
-					continue;
-				}
-			} // arg not set
-			else {
-				// Store True (not set)
-				if (it->second.arg_type == ArgType::tStoreTrue) {
-					_arg_map_bool[it->first] = false;
-					continue;
-				}
-				// Store False (not set)
-				if (it->second.arg_type == ArgType::tStoreFalse) {
-					_arg_map_bool[it->first] = true;
-					continue;
-				}
-			}
+	ParseError::ParseError(ArgErrorCode code, int argv_index, std::string_view token, const ArgConfig * arg, const ArgConfig * other):
+		code(code),
+		argv_index(argv_index),
+		token(token),
+		arg(arg),
+		other(other)
+	{
+	}
+
+	std::string ParseError::message() const
+	{
+		std::string count = this->arg ? std::to_string(this->arg->nargs_min) : std::string();
+		switch (this->code) {
+		case NO_ERROR:
+			return "";
+		case POSITIONAL_ERROR:
+			if (!this->arg)
+				return "Not enough positional arguments provided";
+			return "Positional argument can't start with '-' character\nError while parsing positional argument: " + std::string(this->arg->arg_name);
+		case OPTIONAL_PROVIDED_WITH_NO_VALUE:
+			return "[argparse] Optional parameter '" + std::string(this->arg->arg_name) + "' provided with no value";
+		case NARGS_ERROR:
+			if (this->arg->arg_imp == ArgImportance::iPositional)
+				return "Positional argument '" + std::string(this->arg->arg_name) + "' expects " + count + " value(s)";
+			return "[argparse] Optional parameter '" + std::string(this->arg->arg_name) + "' expects " + count + " value(s)";
+		case CONVERT_ARG_ERROR:
+		case CONVERT_ARG_RANGE_ERROR:
+			return convert_error_message(*this->arg, this->token, this->code);
+		case CHOICE_ERROR:
+			return choice_error_message(*this->arg, this->token);
+		case SNAPSHOT_ERROR:
+			return "[argparse] Can't load snapshot: " + std::string(this->token);
+		case RESPONSE_FILE_ERROR:
+			return "Can't read response file '" + std::string(this->token) + "'";
+		case RESPONSE_FILE_DEPTH_ERROR:
+			return "Response files nested too deeply at '" + std::string(this->token) + "'";
+		case SUBCOMMAND_ERROR:
+			return "Unknown subcommand '" + std::string(this->token) + "'";
+		case AMBIGUOUS_OPTION_ERROR:
+			return "[argparse] Ambiguous option '" + std::string(this->token) + "'";
+		case REQUIRED_ERROR:
+			if (!this->arg)
+				return "[argparse] One of " + std::string(this->token) + " is required";
+			return "[argparse] Optional parameter '" + std::string(this->arg->arg_name) + "' is required";
+		case EXCLUSIVE_ERROR:
+			return "[argparse] Optional parameters '" + std::string(this->arg->arg_name) + "' and '" + std::string(this->other->arg_name) + "' are mutually exclusive";
+		case REQUIRES_ERROR:
+			return "[argparse] Optional parameter '" + std::string(this->arg->arg_name) + "' requires '" + std::string(this->other->arg_name) + "'";
+		case CONFLICT_ERROR:
+			return "[argparse] Optional parameter '" + std::string(this->arg->arg_name) + "' conflicts with '" + std::string(this->other->arg_name) + "'";
+		case SHORT_OPTION_ERROR:
+			return "[argparse] Unknown short option '-" + std::string(this->token) + "'";
+		case UNKNOWN_ARGUMENT_ERROR:
+			return "Unexpected argument '" + std::string(this->token) + "'";
+		case CONFIG_FILE_ERROR:
+			return "Can't read config file '" + std::string(this->token) + "'";
+		case COMMAND_LINE_ERROR:
+			return "Unterminated quote in command line at: " + std::string(this->token);
+		default:
+			return "Error while parsing argument '" + std::string(this->token) + "'";
 		}
 	}
 
-	ArgumentParser::ArgumentParser(const std::string & description, const std::string & app_name, const std::string & author):
-		description(description),
-		exec_name(app_name),
-		author(author)
+	Error::Error(ArgErrorCode code, const std::string & msg):
+		code(code),
+		msg(msg)
 	{
-		this->_init();
 	}
 
-	ArgumentParser::ArgumentParser():
-		description("")
+	Error::Error():
+		code(NO_ERROR)
 	{
-		this->_init();
 	}
 
-	ArgumentParser::~ArgumentParser()
+	const char * Error::what() const noexcept
 	{
+		return this->msg.c_str();
 	}
 
-	bool ArgumentParser::parse_check_help(int argc, char * argv[]) {
-		std::string help[2] = {"--help", "/?"};
-		std::string temp("");
-		for (int i = 0; i < argc; ++i) {
-			temp = argv[i];
-			for (int j = 0; j < 2; ++j) {
-				if (temp == help[j])
-					return true;
+
+	// Columns of the terminal on stdout, see set_help_width()
+	static unsigned int terminal_columns()
+	{
+		int columns = 0;
+		const char * env = std::getenv("COLUMNS");
+		if (env && convert_arg(env, columns) == NO_ERROR && columns > 0)
+			return static_cast<unsigned int>(columns);
+	#if defined(_WIN32)
+		CONSOLE_SCREEN_BUFFER_INFO info;
+		if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+			return static_cast<unsigned int>(info.srWindow.Right - info.srWindow.Left + 1);
+	#else
+		struct winsize size;
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0)
+			return size.ws_col;
+	#endif
+		return 80;
+	}
+
+	// text word-wrapped into lines of width columns, lines after the first
+	// indented by indent; at least 20 columns of text per line
+	static void append_wrapped(std::pmr::string & out, std::string_view text, size_t indent, size_t width)
+	{
+		size_t room = std::max(width > indent ? width - indent : 0, size_t(20));
+		size_t line = 0;
+		while (!text.empty()) {
+			size_t begin = text.find_first_not_of(' ');
+			if (begin == std::string_view::npos)
+				break;
+			text.remove_prefix(begin);
+			size_t word = std::min(text.find(' '), text.size());
+			if (line != 0 && line + 1 + word > room) {
+				out += '\n';
+				out.append(indent, ' ');
+				line = 0;
+			} else if (line != 0) {
+				out += ' ';
+				++line;
 			}
+			out.append(text.data(), word);
+			line += word;
+			text.remove_prefix(word);
 		}
-		return false;
 	}
 
-	void ArgumentParser::add_argument(std::string arg_name, std::string arg_help, ArgType arg_type, ArgImportance arg_imp, ArgSpecialBehavior arg_sb)
+	// "  label" padded to column, then the wrapped help; a label reaching the
+	// column puts the help on the next line
+	static void append_entry(std::pmr::string & out, std::string_view label, std::string_view help, size_t column, size_t width)
 	{
-		if (this->_arguments.count(arg_name) != 0)
-			throw Error(DUPLICATE_ARGUMENT_ERROR, "");
-		if (arg_imp == ArgImportance::iPositional) {
-			++this->positional_count;
-			this->_arguments[arg_name] = ArgConfig(arg_name, arg_help, arg_type, arg_imp, arg_sb, this->positional_count);
+		out.append(2, ' ');
+		out.append(label.data(), label.size());
+		if (label.size() + 2 < column) {
+			out.append(column - label.size() - 2, ' ');
+		} else if (!help.empty()) {
+			out += '\n';
+			out.append(column, ' ');
 		}
-		if (arg_imp == ArgImportance::iOptional) {
-			++this->optional_count;
-			this->_arguments[arg_name] = ArgConfig(arg_name, arg_help, arg_type, arg_imp, arg_sb, -1);
+		append_wrapped(out, help, column, width);
+		out += '\n';
+	}
+
+	void ArgumentParser::_render_help(std::pmr::string & out) const
+	{
+		size_t width = this->_help_width ? this->_help_width : terminal_columns();
+		size_t column = this->_max_arg_name_len;
+		// labels are built on the stack, spilling to the memory of out (the arena)
+		alignas(std::max_align_t) unsigned char stack[512];
+		std::pmr::monotonic_buffer_resource scratch(stack, sizeof(stack), out.get_allocator().resource());
+		std::pmr::string metavar(&scratch);
+		std::pmr::string upper(&scratch);
+
+		out += "usage: ";
+		out.append(this->exec_name.data(), this->exec_name.size());
+		out += ' ';
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			if (it->arg_imp == ArgImportance::iPositional) {
+				append_metavar(out, *it, it->arg_name);
+				out += ' ';
+			}
+		}
+		if (!this->_subcommands.empty())
+			out += "COMMAND ... ";
+		out += '\n';
+		// "[-name] " per optional, wrapped
+		size_t line = 0;
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			if (it->arg_imp != ArgImportance::iOptional)
+				continue;
+			if (line != 0 && line + it->arg_name.size() + 4 > width) {
+				out += '\n';
+				line = 0;
+			}
+			out += "[-";
+			out.append(it->arg_name.data(), it->arg_name.size());
+			out += "] ";
+			line += it->arg_name.size() + 4;
+		}
+		out += '\n';
+		this->_usage_size = out.size();
+
+		out += "\n Author      : ";
+		out.append(this->author.data(), this->author.size());
+		out += "\n Description : ";
+		append_wrapped(out, this->description, 15, width);
+		out += "\n\npositional arguments:\n";
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			if (it->arg_imp == ArgImportance::iPositional)
+				append_entry(out, it->arg_name, it->arg_help, column, width);
+		}
+		out += "\noptional arguments:\n";
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			if (it->arg_imp != ArgImportance::iOptional)
+				continue;
+			metavar.clear();
+			if (it->arg_short && it->arg_name.size() > 1) {
+				metavar += '-';
+				metavar += it->arg_short;
+				metavar += ", ";
+			}
+			metavar += '-';
+			metavar.append(it->arg_name.data(), it->arg_name.size());
+			metavar += ' ';
+			if (it->arg_type == ArgType::tChoice) {
+				metavar += '{';
+				metavar.append(it->arg_choices.data(), it->arg_choices.size());
+				metavar += '}';
+			} else if (it->arg_type != ArgType::tStoreTrue && it->arg_type != ArgType::tStoreFalse && it->arg_type != ArgType::tCount) {
+				upper.assign(it->arg_name.data(), it->arg_name.size());
+				for (auto c = upper.begin(); c != upper.end(); ++c)
+					*c = static_cast<char>(::toupper(static_cast<unsigned char>(*c)));
+				append_metavar(metavar, *it, upper);
+			}
+			append_entry(out, metavar, it->arg_help, column, width);
+		}
+		// names and help only, subcommand schemas are not built
+		if (!this->_subcommands.empty()) {
+			out += "\nsubcommands:\n";
+			for (auto it = this->_subcommands.begin(); it != this->_subcommands.end(); ++it)
+				append_entry(out, (*it)->name, (*it)->help, column, width);
 		}
-		this->arguments_count++;
-		if (_max_arg_name_len < (arg_name.length() * 2) + 4 + 3)
-			_max_arg_name_len = (arg_name.length() * 2) + 4 + 3;
 	}
 
-	Error ArgumentParser::parse_args(int argc, char * argv[]) {
-		_argc = argc;
-		// Save command line params
-		this->raw_arguments.reserve(argc);
-		for (int it = 0; it < argc; ++it) {
-			std::string temp = argv[it];
-			this->raw_arguments.push_back(temp);
+	std::string_view ArgumentParser::help_text() const
+	{
+		// laid out once; parsers are shared between threads, so under a lock
+		if (!this->_help_valid.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(this->_help_mutex);
+			if (!this->_help_valid.load(std::memory_order_relaxed)) {
+				this->_help.clear();
+				this->_render_help(this->_help);
+				this->_help_valid.store(true, std::memory_order_release);
+			}
 		}
-		try {
-			// Parse exec name
-			this->_parse_exec_name();
-			// Sanitize arguments vector for positionals and optionals
-			this->_sanitize_arguments_vector();
-			// Parse optional arguments
-			this->_parse_optional();
-			// Parse positional arguments
-			if(!this->_drop_positional)
-				this->_parse_positional();
-			// Convert arguments
-			this->_convert_arguments();
-		}
-		catch (Error & err) {
-			throw err;
+		return this->_help;
+	}
+
+	std::string_view ArgumentParser::usage_text() const
+	{
+		return this->help_text().substr(0, this->_usage_size);
+	}
+
+	void ArgumentParser::print_help(std::ostream & out) const
+	{
+		std::string_view text = this->help_text();
+		out.write(text.data(), static_cast<std::streamsize>(text.size()));
+	}
+
+	bool ArgumentParser::print_help(int fd) const
+	{
+		std::string_view text = this->help_text();
+		while (!text.empty()) {
+		#if defined(_WIN32)
+			int written = _write(fd, text.data(), static_cast<unsigned int>(text.size()));
+		#else
+			ssize_t written = ::write(fd, text.data(), text.size());
+			if (written < 0 && errno == EINTR)
+				continue;
+		#endif
+			if (written <= 0)
+				return false;
+			text.remove_prefix(static_cast<size_t>(written));
 		}
-		return Error();
+		return true;
 	}
 
-	bool ArgumentParser::is_optional(std::string str)
+	void ArgumentParser::set_help_width(unsigned int columns)
 	{
-		std::cmatch m;
-		return std::regex_match(str.c_str(), m, re_optional_argument);
+		this->_help_width = columns;
+		this->_help_valid.store(false);
 	}
 
-	ArgConfig::ArgConfig(
-		std::string arg_name,
-		std::string arg_help,
-		ArgType arg_type,
-		ArgImportance arg_imp,
-		ArgSpecialBehavior arg_sb,
-		int pos
-	):
-		arg_name(arg_name),
-		arg_help(arg_help),
-		arg_type(arg_type),
-		arg_imp(arg_imp),
-		arg_sb(arg_sb),
-		arg_set(false),
-		arg_str_value(""),
-		pos(pos)
-	{}
+	std::ostringstream ArgumentParser::ret_help() const {
+		std::ostringstream oss;
+		oss << this->help_text();
+		return oss;
+	}
 
-	ArgConfig::ArgConfig():
-		arg_set(false),
-		arg_str_value("")
+	// Snapshot layout, native byte order, no padding (fields are read with memcpy):
+	//   SnapshotHeader
+	//   SnapshotSlot[arguments]
+	//   SnapshotToken[tokens]					sanitized arguments
+	//   int, int64, uint64, float, double[lists[i]]	list values
+	//   char[strings]							string area, referenced by (offset, size)
+	//   char[nested]							snapshot of the subcommand's result
+	static const char snapshot_magic[4] = { 'A', 'P', 'S', 'N' };
+	static const std::uint32_t snapshot_version = 1;
+
+	struct SnapshotHeader {
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t schema;
+		std::uint32_t arguments;
+		std::uint32_t tokens;
+		std::uint32_t lists[5];
+		std::uint32_t strings;
+		std::uint32_t nested;
+		std::uint32_t flags;		// 1: --help, 2: DROP_POSITIONAL_CHECK argument
+		std::uint32_t exec_name[2];
+		std::uint32_t subcommand[2];
+	};
+
+	struct SnapshotSlot {
+		unsigned char value[sizeof(ArgValue)];
+		std::uint32_t str[2];
+		std::uint32_t set;
+		std::uint32_t token;
+		std::uint32_t list_offset;
+		std::uint32_t list_size;
+	};
+
+	struct SnapshotToken {
+		std::uint32_t str[2];
+		std::int32_t argv_index;
+	};
+
+	template <typename T>
+	static inline void snapshot_put(std::string & out, const T & value)
 	{
+		out.append(reinterpret_cast<const char *>(&value), sizeof(T));
 	}
 
-	Error::Error(ArgErrorCode code, const char *  msg):
-		std::exception(msg),
-		code(code),
-		msg(msg)
+	template <typename T>
+	static inline void snapshot_put_list(std::string & out, const std::pmr::vector<T> & list)
 	{
+		if (!list.empty())
+			out.append(reinterpret_cast<const char *>(list.data()), list.size() * sizeof(T));
 	}
 
-	Error::Error():
-		std::exception(""),
-		code(NO_ERROR),
-		msg("")
+	// reads count T at offset into list, false if the blob is too short
+	template <typename T>
+	static inline bool snapshot_get_list(std::string_view blob, size_t & offset, size_t count, std::pmr::vector<T> & list)
 	{
+		if (count > (blob.size() - offset) / sizeof(T))
+			return false;
+		list.resize(count);
+		if (count)
+			std::memcpy(static_cast<void *>(list.data()), blob.data() + offset, count * sizeof(T));
+		offset += count * sizeof(T);
+		return true;
 	}
 
+	// Cached help text and schema hash are built again on next use
+	void ArgumentParser::_schema_changed()
+	{
+		this->_help_valid.store(false);
+		this->_schema_valid.store(false);
+	}
 
-	std::ostringstream ArgumentParser::ret_help() {
-		std::ostringstream oss;
-		auto upper = [](ArgConfig arg)->std::string {
-			std::string upper = arg.arg_name;
-			if (arg.arg_type == ArgType::tStoreTrue || arg.arg_type == ArgType::tStoreFalse) {
-				return "";
+	std::uint64_t ArgumentParser::_schema_hash() const
+	{
+		// parsers are shared between threads, racing threads store the same hash
+		if (this->_schema_valid.load(std::memory_order_acquire))
+			return this->_schema.load(std::memory_order_relaxed);
+		std::uint64_t hash = this->_compute_schema_hash();
+		this->_schema.store(hash, std::memory_order_relaxed);
+		this->_schema_valid.store(true, std::memory_order_release);
+		return hash;
+	}
+
+	// FNV-1a over everything that decides how a snapshot is read
+	std::uint64_t ArgumentParser::_compute_schema_hash() const
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](const void * data, size_t size) {
+			const unsigned char * bytes = static_cast<const unsigned char *>(data);
+			for (size_t i = 0; i < size; ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
 			}
-			for (auto it = upper.begin(); it != upper.end(); ++it) {
-				*it = ::toupper(*it);
+		};
+		auto mix_name = [&mix](std::string_view name) {
+			std::uint32_t size = static_cast<std::uint32_t>(name.size());
+			mix(&size, sizeof(size));
+			mix(name.data(), name.size());
+		};
+		for (auto it = this->_arguments.begin(); it != this->_arguments.end(); ++it) {
+			mix_name(it->arg_name);
+			std::uint32_t shape[6] = {
+				static_cast<std::uint32_t>(it->arg_type), static_cast<std::uint32_t>(it->arg_imp),
+				static_cast<std::uint32_t>(it->arg_sb), static_cast<std::uint32_t>(it->arg_nargs),
+				it->nargs_min, it->nargs_max
+			};
+			mix(shape, sizeof(shape));
+			if (it->arg_type == ArgType::tChoice) {
+				const ArgChoiceSet & set = this->_choice_sets[it->choice_set];
+				for (unsigned int i = 0; i < set.count; ++i) {
+					mix_name(this->_choices[set.first + i].name);
+					mix(&this->_choices[set.first + i].value, sizeof(int));
+				}
 			}
-			return upper;
+		}
+		for (auto it = this->_subcommands.begin(); it != this->_subcommands.end(); ++it)
+			mix_name((*it)->name);
+		return hash;
+	}
+
+	std::string ArgumentParser::save_snapshot(const ParseResult & result) const
+	{
+		if (result._parser != this)
+			throw Error(SNAPSHOT_ERROR, "Result was not parsed by this parser");
+		ParseError error = this->_convert_arguments(result);
+		if (error.code != NO_ERROR)
+			throw Error(error.code, error.message());
+		std::string strings;
+		auto add_string = [&strings](std::string_view str, std::uint32_t * place) {
+			place[0] = static_cast<std::uint32_t>(strings.size());
+			place[1] = static_cast<std::uint32_t>(str.size());
+			strings.append(str.data(), str.size());
 		};
 
-		std::string optional_args_usage = "";
-		std::string positional_args_usage = "";
+		SnapshotHeader header;
+		std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+		header.version = snapshot_version;
+		header.schema = this->_schema_hash();
+		header.arguments = static_cast<std::uint32_t>(this->_arguments.size());
+		header.tokens = static_cast<std::uint32_t>(result.sanitized_arguments.size());
+		header.lists[0] = static_cast<std::uint32_t>(result._int_list.size());
+		header.lists[1] = static_cast<std::uint32_t>(result._int64_list.size());
+		header.lists[2] = static_cast<std::uint32_t>(result._uint64_list.size());
+		header.lists[3] = static_cast<std::uint32_t>(result._float_list.size());
+		header.lists[4] = static_cast<std::uint32_t>(result._double_list.size());
+		header.flags = (result._help ? 1u : 0u) | (result._drop_positional ? 2u : 0u);
+		add_string(result.exec_name, header.exec_name);
+		add_string(result._subcommand, header.subcommand);
 
-		for(auto it=_arguments.begin(); it != _arguments.end(); ++it) {
-			if (it->second.arg_imp == ArgImportance::iOptional) {
-				optional_args_usage += "[-" + it->second.arg_name + "] ";
-			}
-			if (it->second.arg_imp == ArgImportance::iPositional) {
-				positional_args_usage += it->second.arg_name + " ";
+		std::vector<SnapshotToken> tokens(result.sanitized_arguments.size());
+		for (size_t i = 0; i < tokens.size(); ++i) {
+			add_string(result.sanitized_arguments[i], tokens[i].str);
+			tokens[i].argv_index = result._token_argv[i];
+		}
+		std::vector<SnapshotSlot> slots(this->_arguments.size());
+		for (size_t i = 0; i < slots.size(); ++i) {
+			const ArgSlot & slot = result._slots[i];
+			std::memcpy(slots[i].value, &slot.arg_value, sizeof(ArgValue));
+			// values taken from a token point at its copy
+			if (slot.arg_token < tokens.size() && !slot.arg_str_value.empty()
+				&& slot.arg_str_value.data() == result.sanitized_arguments[slot.arg_token].data()
+				&& slot.arg_str_value.size() == result.sanitized_arguments[slot.arg_token].size()) {
+				slots[i].str[0] = tokens[slot.arg_token].str[0];
+				slots[i].str[1] = tokens[slot.arg_token].str[1];
+			} else {
+				add_string(slot.arg_str_value, slots[i].str);
 			}
+			slots[i].set = slot.arg_set ? 1 : 0;
+			slots[i].token = slot.arg_token;
+			slots[i].list_offset = slot.list_offset;
+			slots[i].list_size = slot.list_size;
+		}
 
+		std::string nested;
+		if (!result._subcommand.empty()) {
+			int sub = this->_find_subcommand(result._subcommand);
+			nested = this->_subparser(*this->_subcommands[sub]).save_snapshot(*result._sub_result);
 		}
+		header.strings = static_cast<std::uint32_t>(strings.size());
+		header.nested = static_cast<std::uint32_t>(nested.size());
 
-		oss << "usage: " << exec_name << " ";
-		oss << positional_args_usage << std::endl;
-		oss << optional_args_usage << std::endl;
-		oss << std::endl;
-		oss << " Author      : " << author << std::endl;
-		oss << " Description : " << description << std::endl;
+		std::string out;
+		snapshot_put(out, header);
+		out.append(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(SnapshotSlot));
+		out.append(reinterpret_cast<const char *>(tokens.data()), tokens.size() * sizeof(SnapshotToken));
+		snapshot_put_list(out, result._int_list);
+		snapshot_put_list(out, result._int64_list);
+		snapshot_put_list(out, result._uint64_list);
+		snapshot_put_list(out, result._float_list);
+		snapshot_put_list(out, result._double_list);
+		out += strings;
+		out += nested;
+		return out;
+	}
+
+	ParseError ArgumentParser::load_snapshot(std::string_view blob, ParseResult & result) const
+	{
+		result.reset();
+		this->_start(result);
+		SnapshotHeader header;
+		if (blob.size() < sizeof(header))
+			return ParseError(SNAPSHOT_ERROR, -1, "truncated", nullptr);
+		std::memcpy(&header, blob.data(), sizeof(header));
+		if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0)
+			return ParseError(SNAPSHOT_ERROR, -1, "not a snapshot", nullptr);
+		if (header.version != snapshot_version)
+			return ParseError(SNAPSHOT_ERROR, -1, "other format version", nullptr);
+		if (header.schema != this->_schema_hash() || header.arguments != this->_arguments.size())
+			return ParseError(SNAPSHOT_ERROR, -1, "other arguments", nullptr);
 
-		oss << std::endl << "positional arguments:" << std::endl;
-		for (auto it = _arguments.begin(); it != _arguments.end(); ++it) {
+		size_t offset = sizeof(header);
+		size_t fixed = header.arguments * sizeof(SnapshotSlot) + static_cast<size_t>(header.tokens) * sizeof(SnapshotToken);
+		if (fixed > blob.size() - offset)
+			return ParseError(SNAPSHOT_ERROR, -1, "truncated", nullptr);
+		const char * slots = blob.data() + offset;
+		const char * tokens = slots + header.arguments * sizeof(SnapshotSlot);
+		offset += fixed;
+		if (!snapshot_get_list(blob, offset, header.lists[0], result._int_list)
+			|| !snapshot_get_list(blob, offset, header.lists[1], result._int64_list)
+			|| !snapshot_get_list(blob, offset, header.lists[2], result._uint64_list)
+			|| !snapshot_get_list(blob, offset, header.lists[3], result._float_list)
+			|| !snapshot_get_list(blob, offset, header.lists[4], result._double_list)
+			|| static_cast<size_t>(header.strings) + header.nested != blob.size() - offset)
+			return ParseError(SNAPSHOT_ERROR, -1, "truncated", nullptr);
+		std::string_view strings = blob.substr(offset, header.strings);
+		bool valid = true;
+		auto get_string = [&strings, &valid](const std::uint32_t * place) {
+			if (place[0] > strings.size() || place[1] > strings.size() - place[0]) {
+				valid = false;
+				return std::string_view();
+			}
+			return strings.substr(place[0], place[1]);
+		};
 
-			if (it->second.arg_imp == ArgImportance::iPositional) {
-				oss << std::left << std::setfill(' ') << std::setw(_max_arg_name_len)
-					<< "  " + it->second.arg_name
-					<< it->second.arg_help << std::endl;
+		// strings are views into the blob
+		result.exec_name = get_string(header.exec_name);
+		result._subcommand = get_string(header.subcommand);
+		result._help = (header.flags & 1) != 0;
+		result._drop_positional = (header.flags & 2) != 0;
+		result.sanitized_arguments.reserve(header.tokens);
+		result._token_argv.reserve(header.tokens);
+		for (std::uint32_t i = 0; i < header.tokens; ++i) {
+			SnapshotToken token;
+			std::memcpy(&token, tokens + i * sizeof(SnapshotToken), sizeof(token));
+			result.sanitized_arguments.push_back(get_string(token.str));
+			result._token_argv.push_back(token.argv_index);
+		}
+		for (std::uint32_t i = 0; i < header.arguments; ++i) {
+			SnapshotSlot stored;
+			std::memcpy(&stored, slots + i * sizeof(SnapshotSlot), sizeof(stored));
+			ArgSlot & slot = result._slots[i];
+			std::memcpy(static_cast<void *>(&slot.arg_value), stored.value, sizeof(ArgValue));
+			slot.arg_str_value = get_string(stored.str);
+			slot.arg_set = stored.set != 0;
+			slot.arg_converted = true;
+			slot.arg_token = stored.token;
+			slot.list_offset = stored.list_offset;
+			slot.list_size = stored.list_size;
+			// list values have to lie in the lists that came with them
+			if (this->_arguments[i].is_list() && slot.arg_set) {
+				size_t available = result.sanitized_arguments.size();
+				switch (this->_arguments[i].arg_type) {
+				case ArgType::tInt: available = result._int_list.size(); break;
+				case ArgType::tInt64: available = result._int64_list.size(); break;
+				case ArgType::tUInt64: available = result._uint64_list.size(); break;
+				case ArgType::tFloat: available = result._float_list.size(); break;
+				case ArgType::tDouble: available = result._double_list.size(); break;
+				default: break;
+				}
+				if (slot.list_offset > available || slot.list_size > available - slot.list_offset)
+					valid = false;
 			}
+		}
+		if (!valid)
+			return ParseError(SNAPSHOT_ERROR, -1, "truncated", nullptr);
 
+		if (!result._subcommand.empty()) {
+			int sub = this->_find_subcommand(result._subcommand);
+			if (sub < 0 || header.nested == 0)
+				return ParseError(SNAPSHOT_ERROR, -1, "other arguments", nullptr);
+			result._subcommand = this->_subcommands[sub]->name;
+			ParseError error = this->_subparser(*this->_subcommands[sub]).load_snapshot(blob.substr(offset + header.strings), result._nested());
+			if (error.code != NO_ERROR)
+				return error;
 		}
-		oss << std::endl;
-		oss << "optional arguments:" << std::endl;
-		for (auto it = _arguments.begin(); it != _arguments.end(); ++it) {
-			if (it->second.arg_imp == ArgImportance::iOptional) {
-				optional_args_usage = it->second.arg_name;
+		return this->_store_bindings(result, nullptr);
+	}
 
-				oss << std::left << std::setfill(' ') << std::setw(_max_arg_name_len)
-					<< "  -" + it->second.arg_name + " " + upper(it->second)
-					<< it->second.arg_help << std::endl;
+	ParseError ArgumentParser::load_snapshot_file(const char * path, ParseResult & result) const
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return ParseError(SNAPSHOT_ERROR, -1, "can't read the file", nullptr);
+		std::string_view blob = file.view();
+		ParseError error = this->load_snapshot(blob, result);
+		// the mapping moves, the views into it stay valid
+		result._files.push_back(std::move(file));
+		return error;
+	}
 
-			}
+	ParseError ArgumentParser::load_snapshot_fd(int fd, ParseResult & result) const
+	{
+		MappedFile file;
+		if (!file.open_fd(fd))
+			return ParseError(SNAPSHOT_ERROR, -1, "can't read the file", nullptr);
+		std::string_view blob = file.view();
+		ParseError error = this->load_snapshot(blob, result);
+		result._files.push_back(std::move(file));
+		return error;
+	}
+
+	LockedResource::LockedResource(std::pmr::memory_resource * upstream):
+		_upstream(upstream)
+	{
+	}
+
+	void * LockedResource::do_allocate(size_t bytes, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		return this->_upstream->allocate(bytes, alignment);
+	}
+
+	void LockedResource::do_deallocate(void * p, size_t bytes, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_upstream->deallocate(p, bytes, alignment);
+	}
+
+	bool LockedResource::do_is_equal(const std::pmr::memory_resource & other) const noexcept
+	{
+		return this == &other;
+	}
+
+	ParseStats::ParseStats(std::pmr::memory_resource * upstream):
+		_upstream(upstream)
+	{
+		this->reset();
+	}
+
+	void ParseStats::reset()
+	{
+		this->parses = 0;
+		std::fill(std::begin(this->phase_ns), std::end(this->phase_ns), 0);
+		this->tokens = 0;
+		this->lookups = 0;
+		this->bytes_copied = 0;
+		this->allocations = 0;
+		this->allocated_bytes = 0;
+		std::fill(std::begin(this->histogram), std::end(this->histogram), 0);
+	}
+
+	void ParseStats::merge(const ParseStats & other)
+	{
+		this->parses += other.parses;
+		for (size_t i = 0; i < static_cast<size_t>(ParsePhase::pCount); ++i)
+			this->phase_ns[i] += other.phase_ns[i];
+		this->tokens += other.tokens;
+		this->lookups += other.lookups;
+		this->bytes_copied += other.bytes_copied;
+		this->allocations += other.allocations;
+		this->allocated_bytes += other.allocated_bytes;
+		for (size_t i = 0; i < histogram_size; ++i)
+			this->histogram[i] += other.histogram[i];
+	}
+
+	void ParseStats::add_parse(std::uint64_t ns)
+	{
+		// floor(log2(ns)), 0 and 1 ns share the first bucket
+		size_t bucket = 0;
+		while (ns > 1 && bucket + 1 < histogram_size) {
+			ns >>= 1;
+			++bucket;
 		}
-		return oss;
+		++this->histogram[bucket];
+		++this->parses;
+	}
+
+	const char * ParseStats::phase_name(ParsePhase phase)
+	{
+		switch (phase) {
+		case ParsePhase::pExecName:
+			return "exec_name";
+		case ParsePhase::pTokenize:
+			return "tokenize";
+		case ParsePhase::pValidate:
+			return "validate";
+		case ParsePhase::pSources:
+			return "sources";
+		case ParsePhase::pConvert:
+			return "convert";
+		case ParsePhase::pBind:
+			return "bind";
+		default:
+			return "";
+		}
+	}
+
+	std::string ParseStats::to_json() const
+	{
+		std::ostringstream oss;
+		oss << "{\"parses\":" << this->parses << ",\"phase_ns\":{";
+		for (size_t i = 0; i < static_cast<size_t>(ParsePhase::pCount); ++i)
+			oss << (i ? "," : "") << '"' << phase_name(static_cast<ParsePhase>(i)) << "\":" << this->phase_ns[i];
+		oss << "},\"tokens\":" << this->tokens
+			<< ",\"lookups\":" << this->lookups
+			<< ",\"bytes_copied\":" << this->bytes_copied
+			<< ",\"allocations\":" << this->allocations
+			<< ",\"allocated_bytes\":" << this->allocated_bytes
+			<< ",\"histogram_log2_ns\":[";
+		// trailing empty buckets are left out
+		size_t used = histogram_size;
+		while (used > 0 && this->histogram[used - 1] == 0)
+			--used;
+		for (size_t i = 0; i < used; ++i)
+			oss << (i ? "," : "") << this->histogram[i];
+		oss << "]}";
+		return oss.str();
+	}
+
+	std::string ParseStats::to_key_value() const
+	{
+		std::ostringstream oss;
+		oss << "parses=" << this->parses << "\n";
+		for (size_t i = 0; i < static_cast<size_t>(ParsePhase::pCount); ++i)
+			oss << "phase_ns." << phase_name(static_cast<ParsePhase>(i)) << "=" << this->phase_ns[i] << "\n";
+		oss << "tokens=" << this->tokens << "\n"
+			<< "lookups=" << this->lookups << "\n"
+			<< "bytes_copied=" << this->bytes_copied << "\n"
+			<< "allocations=" << this->allocations << "\n"
+			<< "allocated_bytes=" << this->allocated_bytes << "\n";
+		for (size_t i = 0; i < histogram_size; ++i) {
+			if (this->histogram[i])
+				oss << "histogram_log2_ns." << i << "=" << this->histogram[i] << "\n";
+		}
+		return oss.str();
+	}
+
+	void * ParseStats::do_allocate(size_t bytes, size_t alignment)
+	{
+		++this->allocations;
+		this->allocated_bytes += bytes;
+		return this->_upstream->allocate(bytes, alignment);
+	}
+
+	void ParseStats::do_deallocate(void * p, size_t bytes, size_t alignment)
+	{
+		this->_upstream->deallocate(p, bytes, alignment);
+	}
+
+	bool ParseStats::do_is_equal(const std::pmr::memory_resource & other) const noexcept
+	{
+		return this == &other;
 	}
 
 } // argparse
\ No newline at end of file
@@ -21,11 +21,21 @@
 // SOFTWARE.
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <sstream>
-#include <regex>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
 
 namespace argparse {
 
@@ -36,14 +46,32 @@ namespace argparse {
 		INVALID_OS_SEP,
 		RAW_VECTOR_OUT_OF_RANGE,
 		OPTIONAL_PROVIDED_WITH_NO_VALUE,
-		CONVERT_ARG_ERROR
+		CONVERT_ARG_ERROR,
+		CONVERT_ARG_RANGE_ERROR,
+		RESPONSE_FILE_ERROR,
+		NARGS_ERROR,
+		RESPONSE_FILE_DEPTH_ERROR,
+		BIND_ERROR,
+		SUBCOMMAND_ERROR,
+		AMBIGUOUS_OPTION_ERROR,
+		COMMAND_LINE_ERROR,
+		CONFIG_FILE_ERROR,
+		UNKNOWN_ARGUMENT_ERROR,
+		REQUIRED_ERROR,
+		EXCLUSIVE_ERROR,
+		REQUIRES_ERROR,
+		CONFLICT_ERROR,
+		SHORT_OPTION_ERROR,
+		CHOICE_ERROR,
+		SNAPSHOT_ERROR
 	};
 
 	struct Error: public std::exception {
 		ArgErrorCode code;
-		const char * msg;
-		Error(ArgErrorCode code, const char *  msg);
+		std::string msg;
+		Error(ArgErrorCode code, const std::string & msg);
 		Error();
+		const char * what() const noexcept override;
 	};
 
 	enum class ArgSpecialBehavior {
@@ -57,7 +85,11 @@ namespace argparse {
 		tString,
 		tFloat,
 		tDouble,
-		tInt
+		tInt,
+		tInt64,
+		tUInt64,
+		tCount,		// flag counting its occurrences (-vvv = 3), read as int
+		tChoice		// one of a fixed set of names, read as its int / enum value (see add_choices)
 	};
 
 	enum class ArgImportance {
@@ -65,118 +97,1011 @@ namespace argparse {
 		iOptional
 	};
 
+	// Number of values an argument takes (Python's nargs)
+	enum class ArgNargs {
+		nOne,			// exactly one value, the default
+		nOptional,		// '?': zero or one value
+		nZeroOrMore,	// '*': list
+		nOneOrMore,		// '+': non-empty list
+		nExactly		// N: list of exactly N values
+	};
+
+	// How "@path" arguments are expanded (see ArgumentParser::set_response_files)
+	enum class ResponseFileFormat {
+		fNone,		// "@path" is an ordinary argument
+		fNewline,	// one argument per line, empty lines skipped
+		fNul,		// arguments separated by '\0' (find -print0, /proc/<pid>/cmdline)
+		fAuto		// fNul if the file contains a '\0', fNewline otherwise
+	};
+
+	// Read-only memory mapping of a whole file. Move-only.
+	class MappedFile {
+	public:
+		MappedFile();
+		MappedFile(MappedFile && other) noexcept;
+		MappedFile & operator=(MappedFile && other) noexcept;
+		MappedFile(const MappedFile &) = delete;
+		MappedFile & operator=(const MappedFile &) = delete;
+		~MappedFile();
+
+		// Maps path, false if it can't be opened or mapped
+		bool open(const char * path);
+		inline bool open(const std::string & path) {
+			return this->open(path.c_str());
+		}
+		// Maps the file open on fd, or reads it if it is a pipe. fd stays open.
+		bool open_fd(int fd);
+		void close();
+
+		inline std::string_view view() const {
+			return std::string_view(this->_data, this->_size);
+		}
+	private:
+		const char * _data;
+		size_t _size;
+		void * _mapping;	// Windows file mapping handle, unused elsewhere
+		std::unique_ptr<char[]> _buffer;	// contents of files that can't be mapped (pipes)
+
+		bool _load(std::intptr_t file);		// fd, or HANDLE on Windows
+	};
+
+	// Converted value of one argument, the live member follows ArgConfig::arg_type.
+	// String values stay in ArgSlot::arg_str_value.
+	union ArgValue {
+		int as_int;
+		std::int64_t as_int64;
+		std::uint64_t as_uint64;
+		float as_float;
+		double as_double;
+		bool as_bool;
+		ArgValue() : as_double(0) {}
+	};
+
+	// Schema entry, immutable once registered. Names and help text live in the
+	// parser's arena.
 	struct ArgConfig {
-		std::string arg_name;
-		std::string arg_help;
+		std::string_view arg_name;
+		std::string_view arg_help;
 		ArgType arg_type;
 		ArgImportance arg_imp;
 		ArgSpecialBehavior arg_sb;
-		bool arg_set;
-		std::string arg_str_value;
-		int pos;
-		ArgConfig(std::string arg_name, std::string arg_help,
+		int pos;	// positionals: index of the first token, 1-based
+		ArgNargs arg_nargs;
+		unsigned int nargs_min;
+		unsigned int nargs_max;	// UINT_MAX = unbounded
+		// optionals: environment variable (NUL-terminated, empty for none) and
+		// config file key giving the value when argv doesn't
+		std::string_view arg_env;
+		std::string_view arg_key;
+		char arg_short;		// optionals: single-character alias, '\0' for none
+		// tChoice: the names separated by ',' and the parser's ArgChoiceSet
+		std::string_view arg_choices;
+		unsigned int choice_set;
+		ArgConfig(std::string_view arg_name, std::string_view arg_help,
 				  ArgType arg_type, ArgImportance arg_imp,
-				  ArgSpecialBehavior arg_sb, int pos);
+				  ArgSpecialBehavior arg_sb, int pos,
+				  ArgNargs arg_nargs = ArgNargs::nOne, unsigned int nargs_count = 1);
 		ArgConfig();
+
+		// Values are a list (nargs '*', '+' or N), read with get_list()
+		inline bool is_list() const {
+			return this->arg_nargs != ArgNargs::nOne && this->arg_nargs != ArgNargs::nOptional;
+		}
 	};
 
-	class ArgumentParser {
+	// Parse state of one argument, same index as its ArgConfig
+	struct ArgSlot {
+		bool arg_set;
+		bool arg_sourced;	// set from the environment or config file, not argv
+		std::string_view arg_str_value;
+		ArgValue arg_value;
+		bool arg_converted;	// arg_value / list values are valid
+		// sanitized token index of the value, for error reports
+		unsigned int arg_token;
+		// list arguments: values are list_offset.. in the result's list of that type
+		unsigned int list_offset;
+		unsigned int list_size;
+		ArgSlot();
+	};
+
+	// Contiguous, read-only view of the values of a list argument
+	template <typename T>
+	struct ArgSpan {
+		const T * data;
+		size_t size;
+		ArgSpan(): data(nullptr), size(0) {}
+		ArgSpan(const T * data, size_t size): data(data), size(size) {}
+		inline const T * begin() const { return this->data; }
+		inline const T * end() const { return this->data + this->size; }
+		inline const T & operator[](size_t i) const { return this->data[i]; }
+		inline bool empty() const { return this->size == 0; }
+	};
+
+	// ArgType of the elements of ArgSpan<T>
+	template <typename T> struct ArgListType;
+	template <> struct ArgListType<std::string_view> { static const ArgType type = ArgType::tString; };
+	template <> struct ArgListType<int> { static const ArgType type = ArgType::tInt; };
+	template <> struct ArgListType<std::int64_t> { static const ArgType type = ArgType::tInt64; };
+	template <> struct ArgListType<std::uint64_t> { static const ArgType type = ArgType::tUInt64; };
+	template <> struct ArgListType<float> { static const ArgType type = ArgType::tFloat; };
+	template <> struct ArgListType<double> { static const ArgType type = ArgType::tDouble; };
+
+	// Token -> value conversion used by the parsers. Locale independent, no allocation.
+	// Integers: optional sign, decimal (leading zeros allowed), 0x hex, 0b binary or 0o octal.
+	// Floating point: optional sign, decimal or exponent notation.
+	// Returns NO_ERROR, CONVERT_ARG_ERROR (malformed) or CONVERT_ARG_RANGE_ERROR (overflow).
+	ArgErrorCode convert_arg(std::string_view str, int & target);
+	ArgErrorCode convert_arg(std::string_view str, std::int64_t & target);
+	ArgErrorCode convert_arg(std::string_view str, std::uint64_t & target);
+	ArgErrorCode convert_arg(std::string_view str, float & target);
+	ArgErrorCode convert_arg(std::string_view str, double & target);
+
+	// Bulk conversion of count tokens into target[0..count), same grammar as convert_arg().
+	// Plain decimal tokens take a SWAR fast path, 8 digits per step.
+	// On error failed is the index of the offending token.
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, int * target, size_t & failed);
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, std::int64_t * target, size_t & failed);
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, std::uint64_t * target, size_t & failed);
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, float * target, size_t & failed);
+	ArgErrorCode convert_args(const std::string_view * tokens, size_t count, double * target, size_t & failed);
+
+	// How a bound variable is written (see ArgumentParser::add_argument(name, help, T * target))
+	enum class ArgBindKind {
+		bValue,			// arithmetic or bool, copied out of ArgValue
+		bString,		// std::string, assigned from the token
+		bStringView		// std::string_view into argv
+	};
+
+	// ArgType and ArgBindKind of a bound variable of type T
+	template <typename T> struct ArgBindTraits;
+	template <> struct ArgBindTraits<int> { static const ArgType type = ArgType::tInt; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<std::int64_t> { static const ArgType type = ArgType::tInt64; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<std::uint64_t> { static const ArgType type = ArgType::tUInt64; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<float> { static const ArgType type = ArgType::tFloat; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<double> { static const ArgType type = ArgType::tDouble; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<bool> { static const ArgType type = ArgType::tStoreTrue; static const ArgBindKind kind = ArgBindKind::bValue; };
+	template <> struct ArgBindTraits<std::string> { static const ArgType type = ArgType::tString; static const ArgBindKind kind = ArgBindKind::bString; };
+	template <> struct ArgBindTraits<std::string_view> { static const ArgType type = ArgType::tString; static const ArgBindKind kind = ArgBindKind::bStringView; };
+
+	// Variable an argument is bound to
+	struct ArgBinding {
+		unsigned int index;			// argument in the parser's table
+		void * target;				// bound variable, nullptr for a member
+		// member: the member pointer's bytes, and locate() applying it to a config struct
+		unsigned char member[16];
+		void * (*locate)(void * object, const unsigned char * member);
+		ArgType type;
+		ArgBindKind kind;
+		unsigned char size;			// bValue: sizeof the variable
+		bool has_default;
+		ArgValue default_value;		// bValue default, same bytes as the variable
+		std::string_view default_str;	// string default, in the parser's arena
+	};
+
+	// Node of the option name trie: children are a sibling list, indexes into one vector
+	struct ArgTrieNode {
+		static constexpr unsigned int several = ~0u;
+		unsigned int child;		// first child, 0 for none (0 is the root)
+		unsigned int sibling;	// next child of the parent, 0 for none
+		unsigned int entry;		// 1 + argument whose name ends here, 0 for none
+		unsigned int unique;	// 1 + the only argument below, several for more than one
+		char label;
+
+		ArgTrieNode(char label, unsigned int sibling, unsigned int unique):
+			child(0), sibling(sibling), entry(0), unique(unique), label(label) {}
+	};
+
+	// Cross-argument rule. Its mask (ArgumentParser::_rule_masks) has one bit per
+	// argument index and is checked against the bits of the given arguments.
+	enum class ArgRuleKind {
+		rRequired,		// every argument of the mask
+		rExclusive,		// at most one of the mask
+		rOneOf,			// exactly one of the mask
+		rRequires,		// subject given: every argument of the mask
+		rConflicts		// subject given: none of the mask
+	};
+
+	struct ArgRule {
+		ArgRuleKind kind;
+		unsigned int subject;
+		std::string_view names;		// groups: "'a', 'b'" for error messages
+	};
+
+	// Name and value of a tChoice argument
+	struct ArgChoice {
+		std::string_view name;
+		int value;
+	};
+
+	// Names of one tChoice argument: ArgumentParser::_choices[first, first + count),
+	// found through a minimal perfect hash whose tables start at
+	// ArgumentParser::_choice_table[table]: count bucket displacements, then
+	// count slots holding the index of the name hashed there.
+	struct ArgChoiceSet {
+		unsigned int first;
+		unsigned int count;
+		unsigned int table;
+		bool ignore_case;
+	};
+
+	class ArgumentParser;
+	class ParseResult;
+
+	// Frees a nested ParseResult from the memory resource it was allocated in
+	struct ParseResultDeleter {
+		std::pmr::memory_resource * resource;
+		void operator()(ParseResult * result) const;
+	};
+
+	// Error of ArgumentParser::try_parse(). Holds views only, the text is built by
+	// message() when asked for, so reporting an error does not allocate.
+	struct ParseError {
+		ArgErrorCode code;
+		int argv_index;				// argv index of the offending token, -1 if there is none
+		std::string_view token;		// offending token (view into argv or a response file)
+		const ArgConfig * arg;		// argument involved, nullptr if none
+		const ArgConfig * other;	// second argument of a violated rule, nullptr if none
+
+		ParseError();
+		ParseError(ArgErrorCode code, int argv_index, std::string_view token, const ArgConfig * arg,
+				   const ArgConfig * other = nullptr);
+
+		// Name of the argument involved, empty if none
+		inline std::string_view name() const {
+			return this->arg ? std::string_view(this->arg->arg_name) : std::string_view();
+		}
+
+		inline explicit operator bool() const {
+			return this->code != NO_ERROR;
+		}
+
+		// Same text as Error::what() of the throwing API
+		std::string message() const;
+	};
+
+	// Phases of a parse timed by ParseStats
+	enum class ParsePhase {
+		pExecName,		// argv[0]
+		pTokenize,		// the single pass: sanitizing, options, positionals, response files
+		pValidate,		// missing values and positionals
+		pSources,		// environment variables and config file
+		pConvert,		// eager conversion of the values
+		pBind,			// writing bound variables
+		pCount
+	};
+
+	// Statistics of the parses into a result (ParseResult::set_stats). Counters add
+	// up over parses, so a long-running service can keep one per thread and merge()
+	// them. Timings and counters are only filled when argparse.cpp is built with
+	// ARGPARSE_STATS; without it the parser has no instrumentation at all.
+	// A ParseStats is also a memory resource: a ParseResult constructed on it has
+	// its allocations counted (with or without ARGPARSE_STATS), then passed on to upstream.
+	class ParseStats: public std::pmr::memory_resource {
+	public:
+		static const size_t histogram_size = 40;
+
+		std::uint64_t parses;
+		std::uint64_t phase_ns[static_cast<size_t>(ParsePhase::pCount)];
+		std::uint64_t tokens;			// sanitized tokens
+		std::uint64_t lookups;			// option name lookups
+		std::uint64_t bytes_copied;		// into bound std::string variables
+		std::uint64_t allocations;
+		std::uint64_t allocated_bytes;
+		// whole parse times: bucket i counts parses of [2^i, 2^(i+1)) ns
+		std::uint64_t histogram[histogram_size];
+
+		explicit ParseStats(std::pmr::memory_resource * upstream = std::pmr::get_default_resource());
+
+		void reset();
+		void merge(const ParseStats & other);
+		// Records one parse of the given duration
+		void add_parse(std::uint64_t ns);
+
+		// {"parses":..,"phase_ns":{..},..,"histogram_log2_ns":[..]}
+		std::string to_json() const;
+		// one "key=value" per line
+		std::string to_key_value() const;
+
+		static const char * phase_name(ParsePhase phase);
+
+	private:
+		std::pmr::memory_resource * _upstream;
+
+		void * do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void * p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override;
+	};
+
+	// Memory resource that serialises access to upstream. A parser's arena is
+	// used after setup too, from const members that may run on several threads
+	// (help text, subcommand parsers built on first use); those go through this.
+	class LockedResource: public std::pmr::memory_resource {
+	public:
+		explicit LockedResource(std::pmr::memory_resource * upstream);
+
+	private:
+		std::pmr::memory_resource * _upstream;
+		std::mutex _mutex;
+
+		void * do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void * p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override;
+	};
+
+	// Values of one parse_args() call. Reusable: each parse resets it but keeps
+	// its buffers, so parsing again with the same schema does not allocate.
+	// Buffers come from the memory resource given at construction.
+	// String values are views into the parsed argv.
+	// A result is not synchronised; use one per thread. With lazy conversion
+	// get_arg() fills the value cache, so that includes reading it.
+	class ParseResult {
+		friend class ArgumentParser;
 	public:
-		inline bool get_arg(std::string name, std::string & target) {
-			target = (_arg_map_string.count(name)) ? _arg_map_string[name] : "";
-			return (target != "") ? true : false;
+		ParseResult();
+		explicit ParseResult(std::pmr::memory_resource * resource);
+
+		// Forget all values, keep capacity
+		void reset();
+
+		// Converts every value that is not converted yet and throws the Error of the
+		// first argument (in registration order) that fails. With lazy conversion
+		// (ArgumentParser::set_lazy_conversion) errors otherwise surface in get_arg().
+		void validate_all() const;
+
+		// validate_all() without throwing
+		ParseError try_validate_all() const;
+
+		// Copies the value out of argv
+		inline bool get_arg(std::string_view name, std::string & target) const {
+			std::string_view view;
+			bool ret = get_arg(name, view);
+			target.assign(view.data(), view.size());
+			return ret;
 		}
 
-		inline bool get_arg(std::string name, int & target) {
-			target = (_arg_map_int.count(name)) ? _arg_map_int[name] : 0;
-			return (target != 0) ? true : false;
+		// View into argv, no copy.
+		// get_arg() returns true when the argument was given, even as "" or 0.
+		inline bool get_arg(std::string_view name, std::string_view & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tString);
+			target = slot ? slot->arg_str_value : std::string_view();
+			return slot != nullptr;
 		}
 
-		inline bool get_arg(std::string name, float & target) {
-			target = (_arg_map_float.count(name)) ? _arg_map_float[name] : 0;
-			return (target != 0) ? true : false;
+		inline bool get_arg(std::string_view name, int & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tInt);
+			target = slot ? slot->arg_value.as_int : 0;
+			return slot != nullptr;
 		}
 
-		inline bool get_arg(std::string name, double & target) {
-			target = (_arg_map_double.count(name)) ? _arg_map_double[name] : 0;
-			return (target != 0) ? true : false;
+		inline bool get_arg(std::string_view name, std::int64_t & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tInt64);
+			target = slot ? slot->arg_value.as_int64 : 0;
+			return slot != nullptr;
 		}
 
-		inline bool get_arg(std::string name, bool & target) {
-			if (_arg_map_bool.count(name)) {
-				target = _arg_map_bool[name];
-				return true;
-			}
-			return false;
+		inline bool get_arg(std::string_view name, std::uint64_t & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tUInt64);
+			target = slot ? slot->arg_value.as_uint64 : 0;
+			return slot != nullptr;
+		}
+
+		inline bool get_arg(std::string_view name, float & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tFloat);
+			target = slot ? slot->arg_value.as_float : 0;
+			return slot != nullptr;
+		}
+
+		inline bool get_arg(std::string_view name, double & target) const {
+			const ArgSlot * slot = _find_value(name, ArgType::tDouble);
+			target = slot ? slot->arg_value.as_double : 0;
+			return slot != nullptr;
+		}
+
+		// tChoice arguments into their enum
+		template <typename E, typename std::enable_if<std::is_enum<E>::value, int>::type = 0>
+		inline bool get_arg(std::string_view name, E & target) const {
+			int value;
+			bool ret = get_arg(name, value);
+			target = static_cast<E>(value);
+			return ret;
+		}
+
+		// A flag that is not given still fills target with its default
+		// (false for tStoreTrue, true for tStoreFalse) but returns false
+		inline bool get_arg(std::string_view name, bool & target) const {
+			const ArgSlot * slot = _find_flag(name);
+			if (!slot)
+				return false;
+			target = slot->arg_value.as_bool;
+			return slot->arg_set;
+		}
+
+		// Values of a list argument (nargs '*', '+' or N), views into this result.
+		// Empty if the argument was not given or is not a list of T.
+		template <typename T>
+		inline ArgSpan<T> get_list(std::string_view name) const {
+			const ArgSlot * slot = _find_list(name, ArgListType<T>::type);
+			if (!slot)
+				return ArgSpan<T>();
+			return ArgSpan<T>(_list_data(static_cast<const T *>(nullptr)) + slot->list_offset, slot->list_size);
+		}
+
+		// Copies the values of a list argument
+		template <typename T>
+		inline bool get_arg(std::string_view name, std::vector<T> & target) const {
+			ArgSpan<T> values = get_list<T>(name);
+			target.assign(values.begin(), values.end());
+			return _find_list(name, ArgListType<T>::type) != nullptr;
+		}
+
+		inline bool get_arg(std::string_view name, std::vector<std::string> & target) const {
+			ArgSpan<std::string_view> values = get_list<std::string_view>(name);
+			target.assign(values.begin(), values.end());
+			return _find_list(name, ArgType::tString) != nullptr;
+		}
+
+		inline bool is_drop_positional_check() const {
+			return this->_drop_positional;
+		}
+
+		// "--help" or "/?" was given; positional checks are skipped then
+		inline bool is_help_requested() const {
+			return this->_help;
 		}
+
+		// Executable name from argv[0], path stripped
+		inline std::string_view get_exec_name() const {
+			return this->exec_name;
+		}
+
+		// Subcommand given on the command line, empty for none
+		inline std::string_view get_subcommand() const {
+			return this->_subcommand;
+		}
+
+		// Values of the subcommand's arguments, nullptr when no subcommand was given
+		inline const ParseResult * get_subcommand_result() const {
+			return this->_subcommand.empty() ? nullptr : this->_sub_result.get();
+		}
+
+		// Error of the parse that filled this result (parse_batch() does not throw).
+		// code is NO_ERROR when the parse succeeded.
+		inline const Error & get_error() const {
+			return this->_error;
+		}
+
+		// Statistics filled by every parse into this result, nullptr to stop
+		inline void set_stats(ParseStats * stats) {
+			this->_stats = stats;
+		}
+
 	private:
-		// maps
-		std::map<std::string, std::string> _arg_map_string;
-		std::map<std::string, int> _arg_map_int;
-		std::map<std::string, double> _arg_map_double;
-		std::map<std::string, float> _arg_map_float;
-		std::map<std::string, bool> _arg_map_bool;
-		
+		const ArgumentParser * _parser;
+		// tokens of argv passed to parse_args(), "--name=value" split in two and
+		// quotes trimmed; views into argv
+		std::pmr::vector<std::string_view> sanitized_arguments;
+		// argv index of each sanitized token, for ParseError
+		std::pmr::vector<int> _token_argv;
+		// conversion caches, filled by const accessors in lazy mode
+		mutable std::pmr::vector<ArgSlot> _slots;
+		// response files the arguments point into, unmapped on reset()
+		std::pmr::vector<MappedFile> _files;
+		// converted values of list arguments, one contiguous run per argument;
+		// string lists are runs of sanitized_arguments
+		mutable std::pmr::vector<int> _int_list;
+		mutable std::pmr::vector<std::int64_t> _int64_list;
+		mutable std::pmr::vector<std::uint64_t> _uint64_list;
+		mutable std::pmr::vector<float> _float_list;
+		mutable std::pmr::vector<double> _double_list;
+		std::string_view exec_name;
+		bool _drop_positional;
+		bool _help;
+		Error _error;
+		// subcommand and its values, the result is kept for reuse
+		std::string_view _subcommand;
+		std::unique_ptr<ParseResult, ParseResultDeleter> _sub_result;
+		ParseStats * _stats;
+		// words of parse_command_line(), unquoted into _line; kept by reset()
+		std::pmr::vector<char> _line;
+		std::pmr::vector<std::string_view> _line_words;
+		// bits of the given arguments, for the rules
+		std::pmr::vector<std::uint64_t> _present;
+
+		ParseResult & _nested();
+		const ArgSlot * _find_value(std::string_view name, ArgType type) const;
+		const ArgSlot * _find_flag(std::string_view name) const;
+		const ArgSlot * _find_list(std::string_view name, ArgType type) const;
+		const ArgSlot * _converted(int index) const;
+
+		inline const std::string_view * _list_data(const std::string_view *) const { return this->sanitized_arguments.data(); }
+		inline const int * _list_data(const int *) const { return this->_int_list.data(); }
+		inline const std::int64_t * _list_data(const std::int64_t *) const { return this->_int64_list.data(); }
+		inline const std::uint64_t * _list_data(const std::uint64_t *) const { return this->_uint64_list.data(); }
+		inline const float * _list_data(const float *) const { return this->_float_list.data(); }
+		inline const double * _list_data(const double *) const { return this->_double_list.data(); }
+	};
+
+	// std::expected-like outcome of ArgumentParser::try_parse(): the filled
+	// result, or the error
+	class ParseOutcome {
+	public:
+		ParseOutcome(ParseResult & result, const ParseError & error): _result(&result), _error(error) {}
+
+		inline bool has_value() const {
+			return this->_error.code == NO_ERROR;
+		}
+
+		inline explicit operator bool() const {
+			return this->has_value();
+		}
+
+		inline ParseResult & value() const {
+			return *this->_result;
+		}
+
+		inline ParseResult & operator*() const {
+			return *this->_result;
+		}
+
+		inline ParseResult * operator->() const {
+			return this->_result;
+		}
+
+		inline const ParseError & error() const {
+			return this->_error;
+		}
+	private:
+		ParseResult * _result;
+		ParseError _error;
+	};
+
+	class ArgumentParser {
+		friend class ParseResult;
+	public:
+		// Values of the last parse_args(argc, argv) call
+		template <typename T>
+		inline bool get_arg(std::string_view name, T & target) const {
+			return this->_result.get_arg(name, target);
+		}
+	private:
+		// schema memory: names, help text and tables, released at once with the parser
+		std::pmr::monotonic_buffer_resource _arena;
+		// _arena for const members, see LockedResource
+		mutable LockedResource _shared;
 		unsigned short arguments_count;
 		unsigned short positional_count;
 		unsigned short optional_count;
+		// positional tokens required, and whether the last positional takes a variable count
+		unsigned int _positional_min;
+		bool _positional_open;
 		size_t _max_arg_name_len;
-		int _argc;
-		std::string exec_name;
-		std::string description;
-		std::string author;
+		std::pmr::string exec_name;
+		std::pmr::string description;
+		std::pmr::string author;
 		char os_sep;
-		std::vector<std::string> raw_arguments;
-		std::vector<std::string> sanitized_arguments;
-		std::map<std::string, ArgConfig> _arguments;
-		bool _drop_positional;
-		std::regex re_optional_argument;
-		std::regex re_float;
-		std::regex re_int;
+		ResponseFileFormat _response_format;
+		char _response_prefix;
+		bool _lazy_conversion;
+		bool _abbreviations;
+		// config file read by every parse, and whether a missing one is an error
+		std::pmr::string _config_path;
+		bool _config_required;
+		std::pmr::string _env_prefix;
+		bool _has_env;
+		// argument table in registration order, names live only here
+		std::pmr::vector<ArgConfig> _arguments;
+		// indices of the positionals in _arguments, in order
+		std::pmr::vector<unsigned int> _positionals;
+		// open addressing name index: 0 = empty, otherwise index into _arguments + 1
+		std::pmr::vector<unsigned int> _arg_index;
+		// bound variables, stored after each successful parse
+		std::pmr::vector<ArgBinding> _bindings;
+		// config struct the member bindings belong to
+		const std::type_info * _bind_struct;
+		// subcommands in registration order, in the arena, and their name index
+		struct Subcommand;
+		std::pmr::vector<Subcommand *> _subcommands;
+		std::pmr::vector<unsigned int> _sub_index;
+		// prefix trie over the names of optional arguments, for abbreviations and completion
+		std::pmr::vector<ArgTrieNode> _trie;
+		// optionals by single-character name or alias: index + 1, 0 for none
+		unsigned short _short_index[128];
+		// config file keys of the optionals, same scheme as _arg_index
+		std::pmr::vector<unsigned int> _key_index;
+		// rules, each with _rule_width words of mask in _rule_masks
+		std::pmr::vector<ArgRule> _rules;
+		std::pmr::vector<std::uint64_t> _rule_masks;
+		size_t _rule_width;
+		// tChoice names and their perfect hash tables, see ArgChoiceSet
+		std::pmr::vector<ArgChoice> _choices;
+		std::pmr::vector<ArgChoiceSet> _choice_sets;
+		std::pmr::vector<unsigned int> _choice_table;
+		// help_text() cache; _help_valid is cleared by every schema change (_schema_changed)
+		unsigned int _help_width;
+		mutable std::mutex _help_mutex;
+		mutable std::atomic<bool> _help_valid;
+		mutable std::pmr::string _help;	// in the arena, through _shared
+		mutable size_t _usage_size;
+		// snapshot schema hash cache, cleared with _help_valid
+		mutable std::atomic<bool> _schema_valid;
+		mutable std::atomic<std::uint64_t> _schema;
+		// result of parse_args(argc, argv)
+		ParseResult _result;
+
+		int _find(std::string_view name) const;
+		int _find_subcommand(std::string_view name) const;
+		void _trie_insert(std::string_view name, unsigned int index);
+		int _trie_walk(std::string_view prefix) const;
+		int _find_abbreviation(std::string_view prefix) const;
+		int _find_option(std::string_view name) const;
+		inline int _find_short(char name) const {
+			unsigned char c = static_cast<unsigned char>(name);
+			return (c < 128) ? static_cast<int>(this->_short_index[c]) - 1 : -1;
+		}
+		void _complete(const std::string_view * words, size_t count, std::string & out) const;
+		const ArgumentParser & _subparser(Subcommand & sub) const;
+		void _index_insert(unsigned int index);
+
+		// single-pass tokenizer, see argparse.cpp
+		struct Tokenizer;
+		bool _at_subcommand(std::string_view token, const Tokenizer & state) const;
 
 		void _init();
-		void _parse_exec_name();
-		void _parse_positional();
-		void _parse_optional();
-		void _sanitize_arguments_vector();
-		void _convert_arguments();
+		std::string_view _intern(std::string_view str);
+		void _bind(std::string_view arg_name, std::string_view arg_help, ArgImportance arg_imp, ArgBinding binding);
+		void _bind_struct_type(const std::type_info & type);
+		void _check_struct_type(const std::type_info & type) const;
+		ParseError _store_bindings(const ParseResult & result, void * object) const;
+		ParseOutcome _try_parse_into(int argc, char * argv[], ParseResult & result, void * object) const;
+
+		template <typename T>
+		inline ArgBinding _make_binding(T * target, const T * default_value) {
+			ArgBinding binding;
+			binding.index = 0;
+			binding.target = target;
+			binding.locate = nullptr;
+			binding.type = ArgBindTraits<T>::type;
+			binding.kind = ArgBindTraits<T>::kind;
+			binding.size = sizeof(T);
+			binding.has_default = default_value != nullptr;
+			binding.default_value.as_uint64 = 0;
+			// a flag always has a default: false when not given
+			if constexpr (std::is_same<T, bool>::value)
+				binding.has_default = true;
+			if (default_value) {
+				if constexpr (ArgBindTraits<T>::kind == ArgBindKind::bValue)
+					std::memcpy(static_cast<void *>(&binding.default_value), default_value, sizeof(T));
+				else
+					binding.default_str = this->_intern(*default_value);
+			}
+			return binding;
+		}
+
+		template <typename C, typename T>
+		inline ArgBinding _make_member_binding(T C::* member, const T * default_value) {
+			static_assert(sizeof(member) <= sizeof(ArgBinding::member), "member pointer too large");
+			ArgBinding binding = this->_make_binding(static_cast<T *>(nullptr), default_value);
+			std::memcpy(binding.member, &member, sizeof(member));
+			binding.locate = &_locate_member<C, T>;
+			return binding;
+		}
+
+		// object->*member for a member pointer stored by _make_member_binding()
+		template <typename C, typename T>
+		static void * _locate_member(void * object, const unsigned char * member) {
+			T C::* pointer;
+			std::memcpy(&pointer, member, sizeof(pointer));
+			return &(static_cast<C *>(object)->*pointer);
+		}
+		std::string_view _parse_exec_name(std::string_view argv0) const;
+		void _start(ParseResult & result) const;
+		bool _tokenize(std::string_view token, Tokenizer & state) const;
+		bool _feed(std::string_view token, Tokenizer & state) const;
+		void _feed_positional(size_t index, bool option, Tokenizer & state) const;
+		void _feed_option(std::string_view token, size_t index, Tokenizer & state) const;
+		void _feed_cluster(std::string_view token, size_t index, Tokenizer & state) const;
+		bool _take_option(unsigned int found, size_t index, Tokenizer & state) const;
+		bool _close_collecting(Tokenizer & state) const;
+		void _gather_positional(size_t index, Tokenizer & state) const;
+		void _close_positional(Tokenizer & state) const;
+		ParseError _validate(Tokenizer & state) const;
+		ParseError _apply_sources(ParseResult & result) const;
+		ParseError _apply_config_file(ParseResult & result) const;
+		ParseError _set_from_source(ParseResult & result, size_t index, std::string_view value) const;
+		int _find_key(std::string_view key) const;
+		unsigned int _rule_arg(std::string_view arg_name) const;
+		void _add_choices(std::string_view arg_name, std::string_view arg_help, size_t first,
+						  ArgImportance arg_imp, bool ignore_case);
+		void _hash_choices(ArgChoiceSet & set);
+		int _find_choice(const ArgChoiceSet & set, std::string_view name) const;
+		std::uint64_t * _rule(ArgRuleKind kind, unsigned int subject, std::string_view names);
+		void _widen_rules();
+		ParseError _check_rules(ParseResult & result) const;
+		void _render_help(std::pmr::string & out) const;
+		void _schema_changed();
+		std::uint64_t _schema_hash() const;
+		std::uint64_t _compute_schema_hash() const;
+		void _rebuild_key_index();
+		void _set_env_name(ArgConfig & arg);
+		ParseError _finish(Tokenizer & state) const;
+		ParseError _convert_arguments(const ParseResult & result) const;
+		ParseError _convert_argument(const ParseResult & result, size_t index) const;
+		void _reserve_lists(ParseResult & result) const;
+		bool _push_argument(std::string_view token, Tokenizer & state, int depth) const;
+		bool _expand_response_file(std::string_view path, Tokenizer & state, int depth) const;
+		template <typename Iterator>
+		ParseError _try_parse(Iterator first, Iterator last, ParseResult & result, void * object) const;
 	public:
-		ArgumentParser(const std::string & description, const std::string & app_name, const std::string & author);
+		// Schema memory comes from an arena on top of upstream and is released
+		// when the parser is destroyed. Not copyable: results point at the parser.
+		ArgumentParser(std::string_view description, std::string_view app_name, std::string_view author,
+					   std::pmr::memory_resource * upstream = std::pmr::get_default_resource());
 		ArgumentParser();
+		explicit ArgumentParser(std::pmr::memory_resource * upstream);
+		// Schema, help text and subcommand parsers all live in buffer, std::bad_alloc
+		// when it is full; setup makes no heap allocation. Parsing allocates from the
+		// result's resource, the heap only for errors, config files and piped response files.
+		ArgumentParser(std::string_view description, std::string_view app_name, std::string_view author,
+					   void * buffer, size_t size);
+		ArgumentParser(void * buffer, size_t size);
+		ArgumentParser(const ArgumentParser &) = delete;
+		ArgumentParser & operator=(const ArgumentParser &) = delete;
 		~ArgumentParser();
 
-		bool parse_check_help(int argc, char * argv[]);
+		bool parse_check_help(int argc, char * argv[]) const;
 
+		// argv is not copied: parsed tokens and string values are views into it,
+		// so argv must outlive the parser (it does for main()'s argv).
+		// Parses into the parser's own result, read back with get_arg().
 		Error parse_args(int argc, char * argv[]);
 
+		// Parses into result and leaves the parser untouched. Any number of threads
+		// can parse against one schema at the same time, each into its own result;
+		// argv must outlive result.
+		void parse_args(int argc, char * argv[], ParseResult & result) const;
+		void parse_args(const std::vector<std::string_view> & args, ParseResult & result) const;
+
+		// parse_args() without exceptions: returns the error instead of throwing it.
+		// A successful parse into a reused result does not allocate, and neither
+		// does a failed one until ParseError::message() is called.
+		ParseOutcome try_parse(int argc, char * argv[], ParseResult & result) const;
+		ParseOutcome try_parse(const std::vector<std::string_view> & args, ParseResult & result) const;
+
+		// Splits line like a POSIX shell (blanks, '...', "...", backslash escapes) and
+		// parses the words, the first one being the executable. Input containing NUL,
+		// such as /proc/<pid>/cmdline, is split on NUL only. The words are unquoted
+		// into result, so line need not outlive it; a reused result does not allocate.
+		// An unterminated quote fails with COMMAND_LINE_ERROR.
+		void parse_command_line(std::string_view line, ParseResult & result) const;
+		ParseOutcome try_parse_command_line(std::string_view line, ParseResult & result) const;
+
+		// Parse that also fills the members of config bound with add_argument(name, help, &C::member)
+		template <typename C>
+		inline ParseOutcome try_parse(int argc, char * argv[], ParseResult & result, C & config) const {
+			this->_check_struct_type(typeid(C));
+			return this->_try_parse_into(argc, argv, result, &config);
+		}
+
+		template <typename C>
+		inline void parse_args(int argc, char * argv[], ParseResult & result, C & config) const {
+			ParseOutcome outcome = this->try_parse(argc, argv, result, config);
+			if (!outcome)
+				throw Error(outcome.error().code, outcome.error().message());
+		}
+
+		// Parses command_lines[i] into results[i] on a pool of worker threads
+		// (0 = one per hardware thread). Errors do not throw, they are stored in
+		// each result's get_error(). results is resized to match, existing
+		// results are reused.
+		void parse_batch(
+			const std::vector<std::vector<std::string_view>> & command_lines,
+			std::vector<ParseResult> & results,
+			unsigned int workers = 0
+		) const;
+
 		inline unsigned short get_arguments_count() const {
 			return this->arguments_count;
 		}
 
-		bool is_optional(std::string str);
+		// True for "-name=value" / "--name=value" tokens. Single pass, no allocation.
+		static bool is_optional(std::string_view str);
 
-		inline bool is_drop_positional_check() {
-			return this->_drop_positional;
+		// True for "-5", "-0.5", "-.5": such tokens are values, not option names.
+		static bool is_negative_number(std::string_view str);
+
+		inline bool is_drop_positional_check() const {
+			return this->_result.is_drop_positional_check();
+		}
+
+		// Expand "<prefix>path" arguments into the arguments stored in that file.
+		// The file is memory-mapped and its arguments are views into the mapping,
+		// owned by the ParseResult. Response files may reference other response files.
+		inline void set_response_files(ResponseFileFormat format, char prefix = '@') {
+			this->_response_format = format;
+			this->_response_prefix = prefix;
+		}
+
+		// Lazy conversion: parsing only records the tokens, each value is converted
+		// on its first get_arg() and cached in the result. Conversion errors are
+		// thrown from get_arg(), or all at once from ParseResult::validate_all().
+		inline void set_lazy_conversion(bool lazy) {
+			this->_lazy_conversion = lazy;
+		}
+
+		// Single-character alias: "-o file", "-ofile", "-o=file" and clusters
+		// such as "-vxo file" where each option but the last is a flag or count
+		void set_short(std::string_view arg_name, char short_name);
+
+		// Rules across arguments, checked after every parse except one with --help
+		// or a DROP_POSITIONAL_CHECK argument. Each is a bitmask over the
+		// arguments, so checking costs a few word operations per rule.
+
+		// The optional must be given
+		void set_required(std::string_view arg_name);
+
+		// At most one of the arguments, or exactly one if required
+		void add_exclusive_group(const std::vector<std::string_view> & arg_names, bool required = false);
+
+		// When arg_name is given, required_name must be too
+		void add_requires(std::string_view arg_name, std::string_view required_name);
+
+		// arg_name and other_name can't be given together
+		void add_conflicts(std::string_view arg_name, std::string_view other_name);
+
+		// Layered sources for optionals, by precedence: default < config file <
+		// environment < argv. Values are views into the mapped file or the
+		// environment and go through the same conversion as argv values.
+		// A flag takes 1/0, true/false, yes/no or on/off; a list takes values
+		// separated by blanks or commas.
+
+		// Environment variable of an optional
+		void set_env(std::string_view arg_name, std::string_view env_var);
+
+		// Environment variable of every optional: prefix + the name in upper case
+		// with '-' as '_' ("APP_" + "number-int" -> APP_NUMBER_INT); set_env() wins
+		void set_env_prefix(std::string_view prefix);
+
+		// INI / key=value file memory-mapped and read by every parse. Keys are the
+		// option names unless set with set_config_key(); "[section]" prefixes the
+		// keys below it with "section.". A missing file is skipped unless required.
+		void set_config_file(std::string_view path, bool required = false);
+		void set_config_key(std::string_view arg_name, std::string_view key);
+
+		// Accept unambiguous prefixes of option names ("--num" for "--number-int");
+		// a prefix of several names fails with AMBIGUOUS_OPTION_ERROR
+		inline void set_abbreviations(bool allow) {
+			this->_abbreviations = allow;
 		}
 
+		// Shell completion: "tool --__complete <words>" prints the candidates for the
+		// last word, one per line, and returns true; the caller exits then. Nothing is
+		// parsed or converted, only the subcommand being completed is built.
+		bool parse_check_complete(int argc, char * argv[]) const;
+
+		// Appends the completion candidates of words.back() to out, one per line;
+		// words is the command line after the executable name
+		void complete(const std::vector<std::string_view> & words, std::string & out) const;
+
 		inline std::string get_description() const {
-			return this->description;
+			return std::string(this->description.data(), this->description.size());
 		}
 
-		inline void set_description(std::string description) {
-			this->description = description;
+		inline void set_description(std::string_view description) {
+			this->description.assign(description.data(), description.size());
+			this->_schema_changed();
 		}
 
 		void add_argument(
-			std::string arg_name,
-			std::string arg_help,
+			std::string_view arg_name,
+			std::string_view arg_help,
 			ArgType arg_type = ArgType::tString,
 			ArgImportance arg_imp = ArgImportance::iPositional,
 			ArgSpecialBehavior arg_sb = ArgSpecialBehavior::None
 		);
 
-		std::ostringstream ret_help();
+		// Binds the argument to a variable: every successful parse stores the value in
+		// *target, or default_value when the argument is not given (without a default
+		// *target is left as it is, a bool becomes false). T is int, int64_t, uint64_t, float, double,
+		// bool (a flag), std::string or std::string_view (a view into argv).
+		template <typename T>
+		inline void add_argument(std::string_view arg_name, std::string_view arg_help, T * target,
+								 ArgImportance arg_imp = ArgImportance::iOptional) {
+			this->_bind(arg_name, arg_help, arg_imp, this->_make_binding(target, static_cast<const T *>(nullptr)));
+		}
+
+		template <typename T>
+		inline void add_argument(std::string_view arg_name, std::string_view arg_help, T * target,
+								 ArgImportance arg_imp, const T & default_value) {
+			this->_bind(arg_name, arg_help, arg_imp, this->_make_binding(target, &default_value));
+		}
+
+		// Binds the argument to a member of a config struct, filled by
+		// parse_args(argc, argv, result, config). All members must be of one struct.
+		template <typename C, typename T>
+		inline void add_argument(std::string_view arg_name, std::string_view arg_help, T C::* member,
+								 ArgImportance arg_imp = ArgImportance::iOptional) {
+			this->_bind_struct_type(typeid(C));
+			this->_bind(arg_name, arg_help, arg_imp, this->_make_member_binding(member, static_cast<const T *>(nullptr)));
+		}
+
+		template <typename C, typename T>
+		inline void add_argument(std::string_view arg_name, std::string_view arg_help, T C::* member,
+								 ArgImportance arg_imp, const T & default_value) {
+			this->_bind_struct_type(typeid(C));
+			this->_bind(arg_name, arg_help, arg_imp, this->_make_member_binding(member, &default_value));
+		}
+
+		// Argument taking nargs values; count is the N of ArgNargs::nExactly.
+		// A positional with a variable count must be the last positional.
+		void add_argument(
+			std::string_view arg_name,
+			std::string_view arg_help,
+			ArgType arg_type,
+			ArgImportance arg_imp,
+			ArgNargs nargs,
+			unsigned int count = 0
+		);
+
+		// Argument taking one of a fixed set of names, read back by get_arg() as the
+		// value of the name (int or enum) or as the given spelling (string). Names
+		// are looked up through a minimal perfect hash built here; an unknown one is
+		// a CHOICE_ERROR naming the closest choice. E is the value type, e.g.
+		// add_choices<Mode>("mode", "Mode", {{"fast", Mode::fast}, {"safe", Mode::safe}})
+		template <typename E = int>
+		inline void add_choices(std::string_view arg_name, std::string_view arg_help,
+								std::initializer_list<std::pair<std::string_view, E>> choices,
+								ArgImportance arg_imp = ArgImportance::iOptional, bool ignore_case = false) {
+			// appended as given, _add_choices() checks and interns them
+			size_t first = this->_choices.size();
+			for (auto it = choices.begin(); it != choices.end(); ++it)
+				this->_choices.push_back(ArgChoice{ it->first, static_cast<int>(it->second) });
+			this->_add_choices(arg_name, arg_help, first, arg_imp, ignore_case);
+		}
+
+		// Subcommand "name", git-style: tool [options] name [subcommand options].
+		// factory registers the subcommand's arguments on an empty parser and is
+		// only called when name is matched on the command line (or by get_subcommand),
+		// so startup cost follows the subcommand that runs. The first non-option
+		// token after the positionals names the subcommand, which parses the rest.
+		void add_subcommand(std::string_view name, std::string_view help, std::function<void(ArgumentParser &)> factory);
+
+		// Parser of a subcommand, built on first use; nullptr for an unknown name
+		const ArgumentParser * get_subcommand(std::string_view name) const;
+
+		// Help text, laid out on first use and cached until arguments are added or
+		// changed. Help columns are wrapped to set_help_width() columns.
+		std::string_view help_text() const;
+
+		// The "usage:" lines at the start of help_text()
+		std::string_view usage_text() const;
+
+		// help_text() in one write, false if the descriptor can't take it all
+		void print_help(std::ostream & out) const;
+		bool print_help(int fd) const;
+
+		// Width help_text() wraps to; 0, the default, uses $COLUMNS, else the
+		// width of the terminal on stdout, else 80
+		void set_help_width(unsigned int columns);
+
+		// Parsed state as a binary snapshot, so worker processes can take over a parse
+		// without parsing. Values are converted first, conversion errors are thrown.
+		// The snapshot is tagged with a format version and a hash of the arguments,
+		// and holds values in native byte order: it is loaded by the same build.
+		std::string save_snapshot(const ParseResult & result) const;
+
+		// Loads a snapshot into result instead of parsing, and stores bound variables.
+		// Strings are views into blob, which has to outlive result. SNAPSHOT_ERROR
+		// for a truncated blob, another format version or other arguments.
+		ParseError load_snapshot(std::string_view blob, ParseResult & result) const;
+
+		// Same from a file, or from a file or pipe open on fd (left open). result
+		// keeps the mapping.
+		ParseError load_snapshot_file(const char * path, ParseResult & result) const;
+		ParseError load_snapshot_fd(int fd, ParseResult & result) const;
+
+		// Copy of help_text(), kept for existing callers
+		std::ostringstream ret_help() const;
 
 	};
 
-} // argparse
\ No newline at end of file
+} // argparse
@@ -0,0 +1,442 @@
+// MIT License
+//
+// Copyright(c) 2018 Bartosz Nowakowski (https://github.com/rolzwy7)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "argparse.h"
+
+// Compile-time schema: arguments are declared as types instead of add_argument() calls.
+//
+//   ARGPARSE_ARG(FilePath, "filepath", "Path to input file", ArgType::tString, ArgImportance::iPositional);
+//   ARGPARSE_ARG(NumberInt, "number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+//   using Parser = argparse::StaticArgumentParser<FilePath, NumberInt>;
+//
+//   auto args = Parser::parse_args(argc, argv);
+//   int n = args.get<NumberInt>();
+//
+// Names are resolved through a perfect hash built by the compiler, values are stored
+// as plain members of the result, and asking for an argument that is not in the schema (or reading
+// it into the wrong type) does not compile.
+
+namespace argparse {
+
+	// Value type produced for each ArgType
+	template <ArgType T> struct ArgValueType {
+		static_assert(T == ArgType::tString,
+			"[argparse] tCount and tChoice are not supported by the compile-time schema, use ArgumentParser");
+		using type = std::string;
+	};
+	template <> struct ArgValueType<ArgType::tInt> { using type = int; };
+	template <> struct ArgValueType<ArgType::tInt64> { using type = std::int64_t; };
+	template <> struct ArgValueType<ArgType::tUInt64> { using type = std::uint64_t; };
+	template <> struct ArgValueType<ArgType::tFloat> { using type = float; };
+	template <> struct ArgValueType<ArgType::tDouble> { using type = double; };
+	template <> struct ArgValueType<ArgType::tStoreTrue> { using type = bool; };
+	template <> struct ArgValueType<ArgType::tStoreFalse> { using type = bool; };
+
+	// Compile-time argument descriptor. A tag type derives from it and adds
+	// arg_name and arg_help (see ARGPARSE_ARG).
+	template <
+		ArgType Type = ArgType::tString,
+		ArgImportance Imp = ArgImportance::iPositional,
+		ArgSpecialBehavior Sb = ArgSpecialBehavior::None
+	>
+	struct Arg {
+		using value_type = typename ArgValueType<Type>::type;
+		static constexpr ArgType arg_type = Type;
+		static constexpr ArgImportance arg_imp = Imp;
+		static constexpr ArgSpecialBehavior arg_sb = Sb;
+	};
+
+#define ARGPARSE_ARG(tag, name, help, ...) \
+	struct tag : ::argparse::Arg<__VA_ARGS__> { \
+		static constexpr std::string_view arg_name = name; \
+		static constexpr std::string_view arg_help = help; \
+	}
+
+	namespace detail {
+
+		constexpr uint32_t fnv1a(std::string_view str, uint32_t seed)
+		{
+			uint32_t hash = 2166136261u ^ seed;
+			for (size_t i = 0; i < str.size(); ++i) {
+				hash ^= static_cast<unsigned char>(str[i]);
+				hash *= 16777619u;
+			}
+			// final mix so that nearby seeds give unrelated slots
+			hash ^= hash >> 15;
+			hash *= 0x2c1b3c6du;
+			hash ^= hash >> 12;
+			return hash;
+		}
+
+		constexpr size_t next_pow2(size_t n)
+		{
+			size_t p = 1;
+			while (p < n)
+				p <<= 1;
+			return p;
+		}
+
+		// Hash-and-displace perfect hash over N keys:
+		//   bucket = fnv1a(key, 0) % N
+		//   slot   = fnv1a(key, displacement[bucket]) & (Slots - 1)
+		// Buckets are placed largest first, each trying displacements until
+		// all of its keys land in free slots.
+		template <size_t N, size_t Slots>
+		struct PerfectHash {
+			std::array<uint32_t, (N ? N : 1)> displacement{};
+			std::array<int, Slots> slots{};
+			bool duplicate_key = false;
+
+			constexpr int find(std::string_view key, const std::array<std::string_view, N> & keys) const
+			{
+				if (N == 0)
+					return -1;
+				uint32_t bucket = fnv1a(key, 0) % (N ? N : 1);
+				int index = slots[fnv1a(key, displacement[bucket]) & (Slots - 1)];
+				return (index >= 0 && keys[index] == key) ? index : -1;
+			}
+		};
+
+		template <size_t N, size_t Slots>
+		constexpr PerfectHash<N, Slots> make_perfect_hash(const std::array<std::string_view, N> & keys)
+		{
+			PerfectHash<N, Slots> ph{};
+			for (size_t i = 0; i < Slots; ++i)
+				ph.slots[i] = -1;
+			// group keys by bucket (counting sort): keys of bucket b are order[start[b] .. start[b + 1])
+			std::array<size_t, N + 1> start{};
+			std::array<size_t, (N ? N : 1)> order{};
+			std::array<size_t, (N ? N : 1)> fill{};
+			size_t max_size = 0;
+			for (size_t i = 0; i < N; ++i)
+				++start[fnv1a(keys[i], 0) % N + 1];
+			for (size_t b = 0; b < N; ++b) {
+				if (start[b + 1] > max_size)
+					max_size = start[b + 1];
+				start[b + 1] += start[b];
+			}
+			for (size_t i = 0; i < N; ++i) {
+				size_t b = fnv1a(keys[i], 0) % N;
+				order[start[b] + fill[b]++] = i;
+			}
+			for (size_t size = max_size; size > 0; --size) {
+				for (size_t b = 0; b < N; ++b) {
+					if (start[b + 1] - start[b] != size)
+						continue;
+					// equal keys share a bucket and could never be separated
+					for (size_t k = 0; k < size; ++k)
+						for (size_t t = k + 1; t < size; ++t)
+							if (keys[order[start[b] + k]] == keys[order[start[b] + t]])
+								ph.duplicate_key = true;
+					if (ph.duplicate_key)
+						return ph;
+					std::array<size_t, (N ? N : 1)> taken{};
+					for (uint32_t d = 1; ; ++d) {
+						bool ok = true;
+						for (size_t k = 0; k < size && ok; ++k) {
+							taken[k] = fnv1a(keys[order[start[b] + k]], d) & (Slots - 1);
+							ok = ph.slots[taken[k]] == -1;
+							for (size_t t = 0; t < k && ok; ++t)
+								ok = taken[t] != taken[k];
+						}
+						if (!ok)
+							continue;
+						for (size_t k = 0; k < size; ++k)
+							ph.slots[taken[k]] = static_cast<int>(order[start[b] + k]);
+						ph.displacement[b] = d;
+						break;
+					}
+				}
+			}
+			return ph;
+		}
+
+		template <typename Tag, typename... Args>
+		constexpr size_t index_of_tag()
+		{
+			constexpr bool matches[] = { std::is_same<Tag, Args>::value..., false };
+			size_t i = 0;
+			while (i < sizeof...(Args) && !matches[i])
+				++i;
+			return i;
+		}
+
+		template <typename A>
+		typename A::value_type default_value()
+		{
+			if constexpr (A::arg_type == ArgType::tStoreFalse)
+				return true;
+			else
+				return typename A::value_type();
+		}
+
+		// One member per argument. Flat inheritance instead of std::tuple keeps
+		// instantiation linear for schemas with hundreds of arguments.
+		template <size_t I, typename A>
+		struct ValueSlot {
+			typename A::value_type value = default_value<A>();
+		};
+
+		template <typename Seq, typename... Args>
+		struct ValueStore;
+
+		template <size_t... Is, typename... Args>
+		struct ValueStore<std::index_sequence<Is...>, Args...> : ValueSlot<Is, Args>... {};
+
+		template <size_t I, typename A>
+		A tag_at(const ValueSlot<I, A> &);
+
+	} // detail
+
+	template <typename... Args>
+	class StaticArgumentParser {
+	public:
+		static constexpr size_t count = sizeof...(Args);
+		static constexpr std::array<std::string_view, count> names = { { Args::arg_name... } };
+
+		// Typed parse result. get<Tag>() only compiles for tags that are part of the schema.
+		class Result {
+			friend class StaticArgumentParser;
+		public:
+			template <typename Tag>
+			const typename Tag::value_type & get() const {
+				return static_cast<const detail::ValueSlot<_index<Tag>(), Tag> &>(_values).value;
+			}
+
+			// Like ParseResult::get_arg(): true when the argument was given; a flag
+			// that was not given still stores its default
+			template <typename Tag, typename T>
+			bool get_arg(T & target) const {
+				static_assert(std::is_same<T, typename Tag::value_type>::value,
+					"[argparse] get_arg target type does not match the argument type");
+				target = get<Tag>();
+				return is_set<Tag>();
+			}
+
+			template <typename Tag>
+			bool is_set() const {
+				return _set[_index<Tag>()];
+			}
+
+			inline bool is_drop_positional_check() const {
+				return this->_drop_positional;
+			}
+
+		private:
+			detail::ValueStore<std::index_sequence_for<Args...>, Args...> _values;
+			std::bitset<count> _set;
+			bool _drop_positional;
+
+			Result() :
+				_drop_positional(false)
+			{}
+
+			template <typename Tag>
+			static constexpr size_t _index() {
+				constexpr size_t index = detail::index_of_tag<Tag, Args...>();
+				static_assert(index < count, "[argparse] argument is not part of this schema");
+				return index;
+			}
+		};
+
+		// Index of the argument called name, -1 if there is none. Usable in constant expressions.
+		static constexpr int find(std::string_view name) {
+			return _hash.find(name, names);
+		}
+
+		// "--name value", "--name=value" and '...' unquoting, then positionals in declaration
+		// order. None of ArgumentParser's nargs, short options, response files, sources or
+		// rules. Throws argparse::Error.
+		static Result parse_args(int argc, char * argv[]);
+
+		static std::ostringstream ret_help(const std::string & exec_name, const std::string & description = "");
+
+	private:
+		using setter = ArgErrorCode(*)(Result &, std::string_view);
+
+		static constexpr detail::PerfectHash<count, detail::next_pow2(2 * count + 1)> _hash =
+			detail::make_perfect_hash<count, detail::next_pow2(2 * count + 1)>(names);
+		static_assert(!_hash.duplicate_key, "[argparse] duplicate argument name in schema");
+		static constexpr std::array<ArgType, count> _types = { { Args::arg_type... } };
+		static constexpr std::array<ArgImportance, count> _imps = { { Args::arg_imp... } };
+		static constexpr std::array<ArgSpecialBehavior, count> _sbs = { { Args::arg_sb... } };
+
+		template <size_t I>
+		static ArgErrorCode _set_value(Result & result, std::string_view token) {
+			using A = decltype(detail::tag_at<I>(result._values));
+			auto & value = static_cast<detail::ValueSlot<I, A> &>(result._values).value;
+			if constexpr (A::arg_type == ArgType::tStoreTrue)
+				value = true;
+			else if constexpr (A::arg_type == ArgType::tStoreFalse)
+				value = false;
+			else if constexpr (A::arg_type == ArgType::tString)
+				value.assign(token.data(), token.size());
+			else if (ArgErrorCode code = convert_arg(token, value))
+				return code;
+			result._set[I] = true;
+			return NO_ERROR;
+		}
+
+		// Error for a bad token, naming the argument and the value like ParseError::message()
+		static Error _value_error(ArgErrorCode code, size_t index, std::string_view token) {
+			std::string name(names[index]);
+			switch (code) {
+			case OPTIONAL_PROVIDED_WITH_NO_VALUE:
+				return Error(code, "[argparse] Optional parameter '" + name + "' provided with no value");
+			case POSITIONAL_ERROR:
+				return Error(code, "Positional argument can't start with '-' character\nError while parsing positional argument: "
+					+ name + " | provided value: " + std::string(token));
+			case CONVERT_ARG_RANGE_ERROR:
+				return Error(code, "Value of argument '" + name + "' out of range | provided value: " + std::string(token));
+			default:
+				return Error(code, "Can't convert argument '" + name + "' | provided value: " + std::string(token));
+			}
+		}
+
+		template <size_t... Is>
+		static constexpr std::array<setter, count> _make_setters(std::index_sequence<Is...>) {
+			return { { &_set_value<Is>... } };
+		}
+
+		// index -> typed store, one indirect call per token
+		static ArgErrorCode _set(size_t index, Result & result, std::string_view token) {
+			static constexpr std::array<setter, count> setters = _make_setters(std::index_sequence_for<Args...>());
+			return setters[index](result, token);
+		}
+	};
+
+	template <typename... Args>
+	typename StaticArgumentParser<Args...>::Result StaticArgumentParser<Args...>::parse_args(int argc, char * argv[])
+	{
+		Result result;
+		// sanitize: split "--name=value", trim single quotes
+		std::vector<std::string_view> tokens;
+		tokens.reserve(argc > 1 ? 2 * (argc - 1) : 0);
+		for (int i = 1; i < argc; ++i) {
+			std::string_view token(argv[i]);
+			if (ArgumentParser::is_optional(token)) {
+				size_t eq = token.find('=');
+				tokens.push_back(token.substr(0, eq));
+				tokens.push_back(token.substr(eq + 1));
+			} else {
+				tokens.push_back(token);
+			}
+		}
+		for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+			if (it->size() >= 2 && it->front() == '\'' && it->back() == '\'')
+				*it = it->substr(1, it->size() - 2);
+		}
+
+		// optionals
+		for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+			if (it->empty() || it->front() != '-' || ArgumentParser::is_negative_number(*it))
+				continue;
+			std::string_view name = *it;
+			while (!name.empty() && name.front() == '-')
+				name.remove_prefix(1);
+			int index = find(name);
+			if (index < 0 || _imps[index] != ArgImportance::iOptional)
+				continue;
+			if (_sbs[index] == ArgSpecialBehavior::DROP_POSITIONAL_CHECK)
+				result._drop_positional = true;
+			if (_types[index] == ArgType::tStoreTrue || _types[index] == ArgType::tStoreFalse) {
+				_set(index, result, name);
+				continue;
+			}
+			if (it + 1 == tokens.end())
+				throw _value_error(OPTIONAL_PROVIDED_WITH_NO_VALUE, index, std::string_view());
+			if (ArgErrorCode code = _set(index, result, *(it + 1)))
+				throw _value_error(code, index, *(it + 1));
+		}
+
+		// positionals, in declaration order
+		if (result._drop_positional)
+			return result;
+		size_t pos = 0;
+		for (size_t index = 0; index < count; ++index) {
+			if (_imps[index] != ArgImportance::iPositional)
+				continue;
+			if (pos >= tokens.size())
+				throw Error(POSITIONAL_ERROR, "Not enough positional arguments provided, missing '" + std::string(names[index]) + "'");
+			std::string_view token = tokens[pos++];
+			if (!token.empty() && token.front() == '-' && !ArgumentParser::is_negative_number(token))
+				throw _value_error(POSITIONAL_ERROR, index, token);
+			if (ArgErrorCode code = _set(index, result, token))
+				throw _value_error(code, index, token);
+		}
+		return result;
+	}
+
+	template <typename... Args>
+	std::ostringstream StaticArgumentParser<Args...>::ret_help(const std::string & exec_name, const std::string & description)
+	{
+		static constexpr std::array<std::string_view, count> helps = { { Args::arg_help... } };
+		size_t width = 0;
+		for (size_t i = 0; i < count; ++i)
+			if (width < names[i].size() * 2 + 4 + 3)
+				width = names[i].size() * 2 + 4 + 3;
+
+		std::ostringstream oss;
+		oss << "usage: " << exec_name << " ";
+		for (size_t i = 0; i < count; ++i)
+			if (_imps[i] == ArgImportance::iPositional)
+				oss << names[i] << " ";
+		oss << std::endl;
+		for (size_t i = 0; i < count; ++i)
+			if (_imps[i] == ArgImportance::iOptional)
+				oss << "[-" << names[i] << "] ";
+		oss << std::endl << std::endl;
+		if (!description.empty())
+			oss << " Description : " << description << std::endl;
+
+		oss << std::endl << "positional arguments:" << std::endl;
+		for (size_t i = 0; i < count; ++i) {
+			if (_imps[i] == ArgImportance::iPositional)
+				oss << std::left << std::setfill(' ') << std::setw(width)
+					<< "  " + std::string(names[i]) << helps[i] << std::endl;
+		}
+		oss << std::endl << "optional arguments:" << std::endl;
+		for (size_t i = 0; i < count; ++i) {
+			if (_imps[i] != ArgImportance::iOptional)
+				continue;
+			std::string upper;
+			if (_types[i] != ArgType::tStoreTrue && _types[i] != ArgType::tStoreFalse)
+				for (auto c : names[i])
+					upper += static_cast<char>(::toupper(static_cast<unsigned char>(c)));
+			oss << std::left << std::setfill(' ') << std::setw(width)
+				<< "  -" + std::string(names[i]) + " " + upper << helps[i] << std::endl;
+		}
+		return oss;
+	}
+
+} // argparse
@@ -0,0 +1,655 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "argparse.h"
+#include "argparse_schema.h"
+
+// Micro benchmarks for parser hot paths, reported as ns/op and heap allocations/op.
+// Built by CMake as the "benchmark" target; in Visual Studio it is excluded
+// from the example project, build it with e.g.
+//   cl /O2 /EHsc /std:c++17 argparse.cpp benchmark.cpp
+
+using argparse::ArgumentParser;
+using argparse::ArgType;
+using argparse::ArgImportance;
+
+// every global operator new, counted; the replacements pair malloc with free
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<std::uint64_t> heap_allocations(0);
+
+void * operator new(std::size_t size)
+{
+	++heap_allocations;
+	if (void * p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// std::pmr::new_delete_resource() allocates with the aligned forms;
+// the block returned by malloc is stored just before the aligned pointer
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+	++heap_allocations;
+	std::size_t align = static_cast<std::size_t>(alignment);
+	void * raw = std::malloc(size + align + sizeof(void *));
+	if (!raw)
+		throw std::bad_alloc();
+	std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *) + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+	reinterpret_cast<void **>(aligned)[-1] = raw;
+	return reinterpret_cast<void *>(aligned);
+}
+
+void operator delete(void * p, std::align_val_t) noexcept
+{
+	if (p)
+		std::free(static_cast<void **>(p)[-1]);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+struct OpCost {
+	double ns;
+	double allocations;
+
+	OpCost operator/(double n) const {
+		return OpCost{ ns / n, allocations / n };
+	}
+};
+
+template <typename F>
+static OpCost ns_per_op(F f, int iterations)
+{
+	std::uint64_t allocations = heap_allocations;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i)
+		f();
+	auto stop = std::chrono::steady_clock::now();
+	return OpCost{ std::chrono::duration<double, std::nano>(stop - start).count() / iterations,
+		static_cast<double>(heap_allocations - allocations) / iterations };
+}
+
+static void report(const std::string & name, const OpCost & cost)
+{
+	std::cout << std::left << std::setw(44) << name
+		<< std::right << std::setw(12) << std::fixed << std::setprecision(1) << cost.ns << " ns/op"
+		<< std::setw(10) << std::setprecision(2) << cost.allocations << " allocs/op" << std::endl;
+}
+
+static volatile bool sink;
+
+ARGPARSE_ARG(BenchFilePath, "filepath", "Path to input file", ArgType::tString, ArgImportance::iPositional);
+ARGPARSE_ARG(BenchOutput, "output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+ARGPARSE_ARG(BenchNumberInt, "number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+ARGPARSE_ARG(BenchNumberDouble, "number-double", "Some double number", ArgType::tDouble, ArgImportance::iOptional);
+ARGPARSE_ARG(BenchVerbose, "v", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+using BenchStaticParser = argparse::StaticArgumentParser<BenchFilePath, BenchOutput, BenchNumberInt, BenchNumberDouble, BenchVerbose>;
+
+static void bench_construct_and_parse()
+{
+	char a0[] = "/usr/bin/example", a1[] = "input.txt", a2[] = "--output=out.txt",
+		a3[] = "-number-int", a4[] = "42", a5[] = "--number-double=3.25", a6[] = "-v";
+	char * argv[] = { a0, a1, a2, a3, a4, a5, a6 };
+
+	report("construct", ns_per_op([]() {
+		ArgumentParser parser("Benchmark", "bench", "rolzwy7");
+	}, 20000));
+
+	report("construct + add_argument + parse", ns_per_op([&argv]() {
+		ArgumentParser parser("Benchmark", "bench", "rolzwy7");
+		parser.add_argument("filepath", "Path to input file");
+		parser.add_argument("output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+		parser.add_argument("number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+		parser.add_argument("number-double", "Some double number", ArgType::tDouble, ArgImportance::iOptional);
+		parser.add_argument("v", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+		parser.parse_args(7, argv);
+	}, 20000));
+
+	report("construct + add_argument, fixed buffer", ns_per_op([]() {
+		char buffer[4096];
+		ArgumentParser parser("Benchmark", "bench", "rolzwy7", buffer, sizeof(buffer));
+		parser.add_argument("filepath", "Path to input file");
+		parser.add_argument("output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+		parser.add_argument("number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+		parser.add_argument("number-double", "Some double number", ArgType::tDouble, ArgImportance::iOptional);
+		parser.add_argument("v", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+	}, 20000));
+
+	ArgumentParser parser("Benchmark", "bench", "rolzwy7");
+	parser.add_argument("filepath", "Path to input file");
+	parser.add_argument("output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("number-double", "Some double number", ArgType::tDouble, ArgImportance::iOptional);
+	parser.add_argument("v", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+	argparse::ParseResult result;
+	report("parse into reused ParseResult", ns_per_op([&]() {
+		parser.parse_args(7, argv, result);
+	}, 200000));
+
+	report("static schema parse", ns_per_op([&argv]() {
+		auto args = BenchStaticParser::parse_args(7, argv);
+		sink = args.get<BenchVerbose>();
+	}, 20000));
+	report("ret_help", ns_per_op([&parser]() {
+		sink = !parser.ret_help().str().empty();
+	}, 20000));
+	report("help_text (cached)", ns_per_op([&parser]() {
+		sink = !parser.help_text().empty();
+	}, 200000));
+	std::ostringstream out;
+	report("print_help to a stream", ns_per_op([&parser, &out]() {
+		out.seekp(0);
+		parser.print_help(out);
+	}, 200000));
+}
+
+static void bench_is_optional()
+{
+	// Pattern used by is_optional() before the hand-written scanner, kept for comparison
+	const std::regex re_optional_argument("^-{1,2}([a-zA-z0-9]-{0,1}){0,}[a-zA-z0-9]+=(('[\\w\\W]+')|(\"[\\w\\W]+\")|([\\w\\W]+))$");
+	std::string hyphenated = "--";
+	for (int i = 0; i < 20; ++i)
+		hyphenated += "ab-";
+	hyphenated += "x";
+	const std::vector<std::string> tokens = { "--output=out.txt", "-number-int", hyphenated };
+
+	for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+		const std::string & token = *it;
+		std::string label = token.length() > 20 ? token.substr(0, 17) + "..." : token;
+		report("is_optional regex   " + label, ns_per_op([&]() {
+			sink = std::regex_match(token, re_optional_argument);
+		}, 20000));
+		report("is_optional scanner " + label, ns_per_op([&]() {
+			sink = ArgumentParser::is_optional(token);
+		}, 20000));
+	}
+}
+
+static void bench_lookup(int options)
+{
+	std::vector<std::string> names;
+	for (int i = 0; i < options; ++i)
+		names.push_back("option-" + std::to_string(i));
+	std::string count = std::to_string(options);
+
+	report("add_argument x" + count, ns_per_op([&names]() {
+		ArgumentParser parser;
+		for (auto it = names.begin(); it != names.end(); ++it)
+			parser.add_argument(*it, "help", ArgType::tInt, ArgImportance::iOptional);
+	}, 200000 / options));
+
+	ArgumentParser parser;
+	for (auto it = names.begin(); it != names.end(); ++it)
+		parser.add_argument(*it, "help", ArgType::tInt, ArgImportance::iOptional);
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < options; i += 3) {
+		store.push_back("--" + names[i]);
+		store.push_back(std::to_string(i));
+	}
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	parser.parse_args(static_cast<int>(argv.size()), argv.data());
+
+	size_t next = 0;
+	report("get_arg with " + count + " options", ns_per_op([&]() {
+		int value;
+		sink = parser.get_arg(names[next], value);
+		next = (next + 1) % names.size();
+	}, 1000000));
+
+	std::vector<std::string_view> words = { "--option-12" };
+	std::string candidates;
+	report("complete '--option-12' with " + count + " options", ns_per_op([&]() {
+		candidates.clear();
+		parser.complete(words, candidates);
+		sink = !candidates.empty();
+	}, 100000));
+}
+
+static void bench_convert()
+{
+	const std::string int_token = "123456789";
+	const std::string double_token = "-1.25e-3";
+	int int_value;
+	double double_value;
+
+	report("int via istringstream", ns_per_op([&]() {
+		std::istringstream iss(int_token);
+		iss >> int_value;
+		sink = int_value != 0;
+	}, 200000));
+	report("int via convert_arg", ns_per_op([&]() {
+		argparse::convert_arg(int_token, int_value);
+		sink = int_value != 0;
+	}, 200000));
+	report("double via istringstream", ns_per_op([&]() {
+		std::istringstream iss(double_token);
+		iss >> double_value;
+		sink = double_value != 0;
+	}, 200000));
+	report("double via convert_arg", ns_per_op([&]() {
+		argparse::convert_arg(double_token, double_value);
+		sink = double_value != 0;
+	}, 200000));
+}
+
+static void bench_scaling()
+{
+	// cost per token should stay flat from 10 to 1,000,000 tokens
+	ArgumentParser parser;
+	parser.add_argument("inputs", "Input files", ArgType::tString, ArgImportance::iPositional, argparse::ArgNargs::nOneOrMore);
+	parser.add_argument("output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("v", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+	argparse::ParseResult result;
+	for (size_t tokens = 10; tokens <= 1000000; tokens *= 10) {
+		std::vector<std::string> store = { "bench" };
+		for (size_t i = 0; i + 2 < tokens; ++i)
+			store.push_back("/data/input/" + std::to_string(i) + ".bin");
+		store.push_back("--output=out.txt");
+		store.push_back("-v");
+		std::vector<char *> argv;
+		for (auto it = store.begin(); it != store.end(); ++it)
+			argv.push_back(&(*it)[0]);
+		int iterations = static_cast<int>(std::max<size_t>(1, 2000000 / tokens));
+		OpCost cost = ns_per_op([&]() {
+			parser.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+		}, iterations);
+		report("parse " + std::to_string(tokens) + " tokens, per token", cost / static_cast<double>(tokens));
+	}
+}
+
+static void bench_command_line()
+{
+	ArgumentParser parser;
+	parser.add_argument("filepath", "Path to input file");
+	parser.add_argument("output", "Path to output file", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("tags", "Tags", ArgType::tString, ArgImportance::iOptional, argparse::ArgNargs::nZeroOrMore);
+	argparse::ParseResult result;
+	const std::string line = "/opt/jobs/bin/ingest '/data/in put/2024-01-01.parquet' --output=/data/out/part-0001.bin "
+		"--number-int 42 --tags \"nightly run\" batch\\ 7 region-eu-west-1";
+	std::string nul_line = "/opt/jobs/bin/ingest";
+	const char * const rest[] = { "/data/in put/2024-01-01.parquet", "--output=/data/out/part-0001.bin",
+		"--number-int", "42", "--tags", "nightly run", "batch 7", "region-eu-west-1" };
+	for (auto word : rest) {
+		nul_line += '\0';
+		nul_line += word;
+	}
+
+	report("parse_command_line, shell quoting", ns_per_op([&]() {
+		parser.parse_command_line(line, result);
+	}, 200000));
+	report("parse_command_line, NUL-separated", ns_per_op([&]() {
+		parser.parse_command_line(nul_line, result);
+	}, 200000));
+}
+
+static void bench_snapshot()
+{
+	// 300 knobs: parsing argv again in a worker vs. loading the supervisor's snapshot
+	ArgumentParser parser;
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < 300; ++i) {
+		std::string name = "knob-" + std::to_string(i);
+		parser.add_argument(name, "help", ArgType::tDouble, ArgImportance::iOptional);
+		store.push_back("--" + name + "=" + std::to_string(i) + ".5e-3");
+	}
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	argparse::ParseResult result;
+	parser.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+	std::string snapshot = parser.save_snapshot(result);
+
+	report("300 knobs, parse argv", ns_per_op([&]() {
+		parser.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+	}, 5000));
+	report("300 knobs, save snapshot", ns_per_op([&]() {
+		sink = !parser.save_snapshot(result).empty();
+	}, 5000));
+	report("300 knobs, load snapshot (" + std::to_string(snapshot.size()) + " B)", ns_per_op([&]() {
+		sink = parser.load_snapshot(snapshot, result).code == argparse::NO_ERROR;
+	}, 5000));
+}
+
+static void bench_choices()
+{
+	// --codec NAME out of 12 choices: perfect hash in the parser vs. the string
+	// compares a tool would otherwise do on the parsed value
+	enum Codec { raw, gzip, bzip2, xz, lz4, zstd, brotli, lzma, snappy, lzo, deflate, zlib };
+	ArgumentParser parser;
+	parser.add_choices<Codec>("codec", "Codec", {
+		{ "raw", raw }, { "gzip", gzip }, { "bzip2", bzip2 }, { "xz", xz }, { "lz4", lz4 }, { "zstd", zstd },
+		{ "brotli", brotli }, { "lzma", lzma }, { "snappy", snappy }, { "lzo", lzo }, { "deflate", deflate }, { "zlib", zlib } });
+	parser.add_argument("codec-name", "Codec", ArgType::tString, ArgImportance::iOptional);
+	const char * names[] = { "raw", "gzip", "bzip2", "xz", "lz4", "zstd", "brotli", "lzma", "snappy", "lzo", "deflate", "zlib" };
+	std::string codec = "zlib";
+	char arg0[] = "bench", option[] = "--codec", option_name[] = "--codec-name";
+	char * argv[] = { arg0, option, &codec[0] };
+	char * argv_name[] = { arg0, option_name, &codec[0] };
+	argparse::ParseResult result;
+
+	report("choice via perfect hash", ns_per_op([&]() {
+		parser.parse_args(3, argv, result);
+		Codec value;
+		result.get_arg("codec", value);
+		sink = value == zlib;
+	}, 200000));
+	report("choice via string compares", ns_per_op([&]() {
+		parser.parse_args(3, argv_name, result);
+		std::string_view value;
+		result.get_arg("codec-name", value);
+		int found = -1;
+		for (int i = 0; i < 12 && found < 0; ++i) {
+			if (value == names[i])
+				found = i;
+		}
+		sink = found == zlib;
+	}, 200000));
+}
+
+static void bench_short_options()
+{
+	// 26 flags and a count: long names vs. the same flags clustered
+	ArgumentParser parser;
+	std::vector<std::string> spelled = { "bench" };
+	std::vector<std::string> clustered = { "bench", "-" };
+	for (char c = 'a'; c <= 'z'; ++c) {
+		std::string name = std::string("flag-") + c;
+		parser.add_argument(name, "help", ArgType::tStoreTrue, ArgImportance::iOptional);
+		parser.set_short(name, c);
+		spelled.push_back("--" + name);
+		clustered[1] += c;
+	}
+	parser.add_argument("verbose", "help", ArgType::tCount, ArgImportance::iOptional);
+	parser.set_short("verbose", 'V');
+	spelled.insert(spelled.end(), 3, "--verbose");
+	clustered.push_back("-VVV");
+	auto make_argv = [](std::vector<std::string> & store) {
+		std::vector<char *> argv;
+		for (auto it = store.begin(); it != store.end(); ++it)
+			argv.push_back(&(*it)[0]);
+		return argv;
+	};
+	std::vector<char *> spelled_argv = make_argv(spelled);
+	std::vector<char *> clustered_argv = make_argv(clustered);
+	argparse::ParseResult result;
+
+	report("26 flags + count, long names", ns_per_op([&]() {
+		parser.parse_args(static_cast<int>(spelled_argv.size()), spelled_argv.data(), result);
+	}, 50000));
+	report("26 flags + count, clustered", ns_per_op([&]() {
+		parser.parse_args(static_cast<int>(clustered_argv.size()), clustered_argv.data(), result);
+	}, 50000));
+}
+
+static void bench_rules()
+{
+	// 200 optionals: plain parse vs. the same parse checking 100 rules
+	ArgumentParser plain, ruled;
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < 200; ++i) {
+		std::string name = "flag-" + std::to_string(i);
+		plain.add_argument(name, "help", ArgType::tStoreTrue, ArgImportance::iOptional);
+		ruled.add_argument(name, "help", ArgType::tStoreTrue, ArgImportance::iOptional);
+		if (i % 4 == 0)
+			store.push_back("--" + name);
+	}
+	for (int i = 0; i < 200; i += 8) {
+		std::string a = "flag-" + std::to_string(i), b = "flag-" + std::to_string(i + 1);
+		std::string c = "flag-" + std::to_string(i + 2), d = "flag-" + std::to_string(i + 3);
+		ruled.add_exclusive_group({ a, b });
+		ruled.add_exclusive_group({ a, b, c, d }, true);
+		ruled.add_requires(a, "flag-" + std::to_string((i + 4) % 200));
+		ruled.add_conflicts(a, "flag-" + std::to_string(i + 5));
+	}
+	ruled.set_required("flag-0");
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	argparse::ParseResult result;
+
+	report("200 flags, no rules", ns_per_op([&]() {
+		plain.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+	}, 20000));
+	report("200 flags, 101 rules", ns_per_op([&]() {
+		ruled.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+	}, 20000));
+}
+
+static void bench_config_sources()
+{
+	// 300 knobs from a config file vs. the same values spelled out in argv
+	const char * path = "argparse_bench.ini";
+	ArgumentParser from_file, from_argv;
+	std::ofstream file(path);
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < 300; ++i) {
+		std::string name = "knob-" + std::to_string(i);
+		from_file.add_argument(name, "help", ArgType::tDouble, ArgImportance::iOptional);
+		from_argv.add_argument(name, "help", ArgType::tDouble, ArgImportance::iOptional);
+		file << name << " = " << i << ".5e-3\n";
+		store.push_back("--" + name + "=" + std::to_string(i) + ".5e-3");
+	}
+	file.close();
+	from_file.set_config_file(path, true);
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	argparse::ParseResult result;
+	char * no_args[] = { &store[0][0] };
+
+	report("300 knobs from argv", ns_per_op([&]() {
+		from_argv.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+	}, 5000));
+	report("300 knobs from mapped config file", ns_per_op([&]() {
+		from_file.parse_args(1, no_args, result);
+	}, 5000));
+	std::remove(path);
+}
+
+static void bench_failing_parse()
+{
+	ArgumentParser parser;
+	parser.add_argument("filepath", "Path to input file");
+	parser.add_argument("number-int", "Some int number", ArgType::tInt, ArgImportance::iOptional);
+	const std::vector<std::string_view> args = { "bench", "input.txt", "--number-int", "4x2" };
+	argparse::ParseResult result;
+
+	report("failing parse, parse_args + catch", ns_per_op([&]() {
+		try {
+			parser.parse_args(args, result);
+		}
+		catch (argparse::Error & err) {
+			sink = err.code != argparse::NO_ERROR;
+		}
+	}, 100000));
+	report("failing parse, try_parse", ns_per_op([&]() {
+		sink = !parser.try_parse(args, result);
+	}, 100000));
+}
+
+static void bench_lazy_conversion()
+{
+	// tool with 300 numeric knobs, all given, of which one is read
+	ArgumentParser parser;
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < 300; ++i) {
+		std::string name = "knob-" + std::to_string(i);
+		parser.add_argument(name, "help", ArgType::tDouble, ArgImportance::iOptional);
+		store.push_back("--" + name + "=" + std::to_string(i) + ".5e-3");
+	}
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	argparse::ParseResult result;
+	double value;
+
+	report("300 knobs, eager conversion", ns_per_op([&]() {
+		parser.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+		sink = result.get_arg("knob-7", value);
+	}, 20000));
+	parser.set_lazy_conversion(true);
+	report("300 knobs, lazy conversion", ns_per_op([&]() {
+		parser.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+		sink = result.get_arg("knob-7", value);
+	}, 20000));
+}
+
+static int & bound_knob(int i)
+{
+	static int knobs[20];
+	return knobs[i];
+}
+
+static void bench_bound_arguments()
+{
+	// 20 options read back by name vs. bound to variables
+	static const char * const names[20] = { "k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8", "k9",
+		"k10", "k11", "k12", "k13", "k14", "k15", "k16", "k17", "k18", "k19" };
+	ArgumentParser by_name, bound;
+	std::vector<std::string> store = { "bench" };
+	for (int i = 0; i < 20; ++i) {
+		by_name.add_argument(names[i], "help", ArgType::tInt, ArgImportance::iOptional);
+		bound.add_argument(names[i], "help", &bound_knob(i), ArgImportance::iOptional, 0);
+		store.push_back(std::string("--") + names[i] + "=" + std::to_string(i * 3));
+	}
+	std::vector<char *> argv;
+	for (auto it = store.begin(); it != store.end(); ++it)
+		argv.push_back(&(*it)[0]);
+	argparse::ParseResult result;
+	int values[20];
+
+	report("20 ints, parse + get_arg by name", ns_per_op([&]() {
+		by_name.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+		for (int i = 0; i < 20; ++i)
+			result.get_arg(names[i], values[i]);
+		sink = values[19] != 0;
+	}, 200000));
+	report("20 ints, parse into bound variables", ns_per_op([&]() {
+		bound.parse_args(static_cast<int>(argv.size()), argv.data(), result);
+		sink = bound_knob(19) != 0;
+	}, 200000));
+}
+
+static void add_tool_options(ArgumentParser & parser)
+{
+	static const char * const names[30] = { "o0", "o1", "o2", "o3", "o4", "o5", "o6", "o7", "o8", "o9",
+		"o10", "o11", "o12", "o13", "o14", "o15", "o16", "o17", "o18", "o19",
+		"o20", "o21", "o22", "o23", "o24", "o25", "o26", "o27", "o28", "o29" };
+	parser.add_argument("file", "Input file");
+	for (int i = 0; i < 30; ++i)
+		parser.add_argument(names[i], "Some option of the subcommand", ArgType::tInt, ArgImportance::iOptional);
+}
+
+static void bench_subcommands()
+{
+	// multi-tool with 200 subcommands of 30 options, one of which runs
+	std::vector<std::string> names;
+	for (int i = 0; i < 200; ++i)
+		names.push_back("cmd" + std::to_string(i));
+	std::vector<std::string_view> args = { "/tool", "cmd123", "in.txt", "--o7=5" };
+	argparse::ParseResult result;
+
+	report("200 subcommands, all schemas built + parse", ns_per_op([&]() {
+		std::vector<std::unique_ptr<ArgumentParser>> tools;
+		for (int i = 0; i < 200; ++i) {
+			tools.emplace_back(new ArgumentParser());
+			add_tool_options(*tools.back());
+		}
+		tools[123]->parse_args(std::vector<std::string_view>(args.begin() + 1, args.end()), result);
+		sink = !result.get_exec_name().empty();
+	}, 200));
+	report("200 subcommands, lazy factories + parse", ns_per_op([&]() {
+		ArgumentParser parser;
+		for (int i = 0; i < 200; ++i)
+			parser.add_subcommand(names[i], "Some subcommand", add_tool_options);
+		parser.parse_args(args, result);
+		sink = !result.get_subcommand().empty();
+	}, 200));
+}
+
+static void bench_convert_list()
+{
+	const size_t count = 1000000;
+	std::vector<std::string> store;
+	store.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		store.push_back(std::to_string(i * 7919 % 100000000));
+	std::vector<std::string_view> tokens(store.begin(), store.end());
+	std::vector<std::string> double_store;
+	double_store.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		double_store.push_back(std::to_string(i % 1000) + "." + std::to_string(i % 97));
+	std::vector<std::string_view> double_tokens(double_store.begin(), double_store.end());
+	std::vector<int> ints(count);
+	std::vector<double> doubles(count);
+
+	report("1M ints via convert_arg (per token)", ns_per_op([&]() {
+		for (size_t i = 0; i < count; ++i)
+			argparse::convert_arg(tokens[i], ints[i]);
+	}, 20) / count);
+	report("1M ints via convert_args (bulk)", ns_per_op([&]() {
+		size_t failed;
+		argparse::convert_args(tokens.data(), count, ints.data(), failed);
+	}, 20) / count);
+	report("1M doubles via convert_arg (per token)", ns_per_op([&]() {
+		for (size_t i = 0; i < count; ++i)
+			argparse::convert_arg(double_tokens[i], doubles[i]);
+	}, 20) / count);
+	report("1M doubles via convert_args (bulk)", ns_per_op([&]() {
+		size_t failed;
+		argparse::convert_args(double_tokens.data(), count, doubles.data(), failed);
+	}, 20) / count);
+	sink = ints[count / 2] != 0 && doubles[count / 2] != 0;
+}
+
+int main()
+{
+	bench_construct_and_parse();
+	bench_scaling();
+	bench_is_optional();
+	bench_lookup(10);
+	bench_lookup(100);
+	bench_lookup(1000);
+	bench_convert();
+	bench_convert_list();
+	bench_lazy_conversion();
+	bench_bound_arguments();
+	bench_subcommands();
+	bench_command_line();
+	bench_snapshot();
+	bench_choices();
+	bench_short_options();
+	bench_rules();
+	bench_config_sources();
+	bench_failing_parse();
+	return 0;
+}
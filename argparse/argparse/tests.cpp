@@ -0,0 +1,1084 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "argparse.h"
+#include "argparse_schema.h"
+
+// Behaviour tests, one function per feature. Built by CMake as the "tests"
+// target and run by ctest, one test per function; in Visual Studio it is
+// excluded from the example project, like benchmark.cpp.
+//   tests             runs all of them
+//   tests <name>      runs one, e.g. "tests choices"
+
+using argparse::ArgumentParser;
+using argparse::ArgType;
+using argparse::ArgImportance;
+using argparse::ArgNargs;
+using argparse::ParseOutcome;
+using argparse::ParseResult;
+
+static int failures = 0;
+
+// every global operator new, counted, for the "no heap" checks; the
+// replacements pair malloc with free
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<std::uint64_t> heap_allocations(0);
+
+void * operator new(std::size_t size)
+{
+	++heap_allocations;
+	if (void * p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// the block returned by malloc is stored just before the aligned pointer
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+	++heap_allocations;
+	std::size_t align = static_cast<std::size_t>(alignment);
+	void * raw = std::malloc(size + align + sizeof(void *));
+	if (!raw)
+		throw std::bad_alloc();
+	std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *) + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+	reinterpret_cast<void **>(aligned)[-1] = raw;
+	return reinterpret_cast<void *>(aligned);
+}
+
+void operator delete(void * p, std::align_val_t) noexcept
+{
+	if (p)
+		std::free(static_cast<void **>(p)[-1]);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+static void check(bool ok, const char * expr, const char * file, int line)
+{
+	if (ok)
+		return;
+	++failures;
+	std::cerr << file << ":" << line << ": check failed: " << expr << std::endl;
+}
+
+#define CHECK(expr) check((expr), #expr, __FILE__, __LINE__)
+
+// args[0] is the executable name; the literals outlive the result
+static ParseOutcome parse(const ArgumentParser & parser, ParseResult & result, const std::vector<std::string_view> & args)
+{
+	return parser.try_parse(args, result);
+}
+
+static void set_env(const char * name, const char * value)
+{
+#if defined(_WIN32)
+	_putenv_s(name, value ? value : "");
+#else
+	if (value)
+		setenv(name, value, 1);
+	else
+		unsetenv(name);
+#endif
+}
+
+static void write_file(const char * path, const std::string & text)
+{
+	std::ofstream out(path, std::ios::binary);
+	out << text;
+}
+
+ARGPARSE_ARG(SchemaFile, "file", "Input", ArgType::tString, ArgImportance::iPositional);
+ARGPARSE_ARG(SchemaCount, "count", "Count", ArgType::tInt, ArgImportance::iOptional);
+ARGPARSE_ARG(SchemaRate, "rate", "Rate", ArgType::tDouble, ArgImportance::iOptional);
+ARGPARSE_ARG(SchemaQuiet, "quiet", "Quiet", ArgType::tStoreTrue, ArgImportance::iOptional);
+ARGPARSE_ARG(SchemaColor, "no-color", "No color", ArgType::tStoreFalse, ArgImportance::iOptional);
+using SchemaParser = argparse::StaticArgumentParser<SchemaFile, SchemaCount, SchemaRate, SchemaQuiet, SchemaColor>;
+
+static_assert(SchemaParser::find("rate") == 2, "names resolve at compile time");
+static_assert(SchemaParser::find("missing") == -1, "unknown names are -1");
+
+// throws argparse::Error, returns its message
+template <typename F>
+static std::string error_of(F f)
+{
+	try {
+		f();
+	}
+	catch (argparse::Error & err) {
+		return err.what();
+	}
+	return std::string();
+}
+
+static void test_static_schema()
+{
+	char arg0[] = "tool", file[] = "in.txt", count[] = "--count=7", rate[] = "--rate", rate_value[] = "0.5", quiet[] = "--quiet";
+	char * argv[] = { arg0, file, count, rate, rate_value, quiet };
+	SchemaParser::Result args = SchemaParser::parse_args(6, argv);
+	CHECK(args.get<SchemaFile>() == "in.txt");
+	CHECK(args.get<SchemaCount>() == 7);
+	CHECK(args.get<SchemaRate>() == 0.5);
+	bool flag = false;
+	CHECK(args.get_arg<SchemaQuiet>(flag) && flag);
+	CHECK(!args.get_arg<SchemaColor>(flag) && flag);
+
+	// flags that are not given: not set, default value
+	char * bare[] = { arg0, file };
+	args = SchemaParser::parse_args(2, bare);
+	CHECK(!args.get_arg<SchemaQuiet>(flag) && !flag);
+	int number = -1;
+	CHECK(!args.get_arg<SchemaCount>(number));
+
+	// errors name the argument and the value
+	char bad_count[] = "--count", bad_value[] = "many";
+	char * bad[] = { arg0, file, bad_count, bad_value };
+	std::string message = error_of([&bad]() { SchemaParser::parse_args(4, bad); });
+	CHECK(message.find("'count'") != std::string::npos && message.find("many") != std::string::npos);
+	char * no_value[] = { arg0, file, bad_count };
+	message = error_of([&no_value]() { SchemaParser::parse_args(3, no_value); });
+	CHECK(message.find("'count'") != std::string::npos);
+	char * none[] = { arg0 };
+	message = error_of([&none]() { SchemaParser::parse_args(1, none); });
+	CHECK(message.find("'file'") != std::string::npos);
+}
+
+static void test_try_parse()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("file", "Input", ArgType::tString, ArgImportance::iPositional);
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("quiet", "Quiet", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.add_argument("no-color", "No color", ArgType::tStoreFalse, ArgImportance::iOptional);
+	ParseResult result;
+
+	ParseOutcome ok = parse(parser, result, { "tool", "in.txt", "--count=010", "--quiet" });
+	CHECK(ok.has_value());
+	std::string_view file;
+	int count = 0;
+	CHECK(result.get_arg("file", file) && file == "in.txt");
+	CHECK(result.get_arg("count", count) && count == 10);
+	CHECK(result.get_exec_name() == "tool");
+
+	// a flag that is not given reads as its default but is not set
+	bool flag = false;
+	CHECK(result.get_arg("quiet", flag) && flag);
+	CHECK(!result.get_arg("no-color", flag) && flag);
+
+	ParseOutcome bad = parse(parser, result, { "tool", "in.txt", "--count", "ten" });
+	CHECK(!bad);
+	CHECK(bad.error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(bad.error().argv_index == 3);
+	CHECK(bad.error().token == "ten");
+	CHECK(bad.error().name() == "count");
+
+	bad = parse(parser, result, { "tool", "in.txt", "--count", "99999999999" });
+	CHECK(bad.error().code == argparse::CONVERT_ARG_RANGE_ERROR);
+
+	bad = parse(parser, result, { "tool", "in.txt", "--count" });
+	CHECK(bad.error().code == argparse::OPTIONAL_PROVIDED_WITH_NO_VALUE);
+	CHECK(bad.error().argv_index == 2);
+
+	bad = parse(parser, result, { "tool" });
+	CHECK(bad.error().code == argparse::POSITIONAL_ERROR);
+	CHECK(bad.error().argv_index == -1);
+
+	// the throwing API reports the same text
+	std::vector<std::string_view> args = { "tool", "in.txt", "--count", "ten" };
+	std::string message = parse(parser, result, args).error().message();
+	try {
+		parser.parse_args(args, result);
+		CHECK(false);
+	}
+	catch (argparse::Error & err) {
+		CHECK(err.code == argparse::CONVERT_ARG_ERROR);
+		CHECK(message == err.what());
+	}
+
+	// integers: leading zeros are decimal, other bases need a prefix
+	int value = 0;
+	CHECK(argparse::convert_arg("08", value) == argparse::NO_ERROR && value == 8);
+	CHECK(argparse::convert_arg("0x1f", value) == argparse::NO_ERROR && value == 31);
+	CHECK(argparse::convert_arg("0b101", value) == argparse::NO_ERROR && value == 5);
+	CHECK(argparse::convert_arg("-0o17", value) == argparse::NO_ERROR && value == -15);
+	CHECK(argparse::convert_arg("0o8", value) == argparse::CONVERT_ARG_ERROR);
+
+	// errors of a subcommand are argv positions of the whole command line
+	parser.add_subcommand("run", "Run", [](ArgumentParser & sub) {
+		sub.add_argument("level", "Level", ArgType::tInt, ArgImportance::iOptional);
+		sub.set_required("level");
+	});
+	bad = parse(parser, result, { "tool", "in.txt", "run", "--level", "high" });
+	CHECK(bad.error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(bad.error().argv_index == 4);
+	bad = parse(parser, result, { "tool", "in.txt", "run" });
+	CHECK(bad.error().code == argparse::REQUIRED_ERROR);
+	CHECK(bad.error().argv_index == -1);
+	ok = parse(parser, result, { "tool", "in.txt", "run", "--level", "3" });
+	CHECK(ok.has_value());
+	CHECK(result.get_subcommand() == "run");
+	int level = 0;
+	CHECK(result.get_subcommand_result() && result.get_subcommand_result()->get_arg("level", level) && level == 3);
+}
+
+static void test_nargs()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("inputs", "Inputs", ArgType::tString, ArgImportance::iPositional, ArgNargs::nOneOrMore);
+	parser.add_argument("sizes", "Sizes", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nZeroOrMore);
+	parser.add_argument("point", "Point", ArgType::tDouble, ArgImportance::iOptional, ArgNargs::nExactly, 2);
+	parser.add_argument("level", "Level", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nOptional);
+	ParseResult result;
+
+	ParseOutcome ok = parse(parser, result, { "tool", "a", "b", "--sizes", "1", "2", "3", "--point", "0.5", "-1.5", "--level" });
+	CHECK(ok.has_value());
+	argparse::ArgSpan<std::string_view> inputs = result.get_list<std::string_view>("inputs");
+	CHECK(inputs.size == 2 && inputs[0] == "a" && inputs[1] == "b");
+	std::vector<int> sizes;
+	CHECK(result.get_arg("sizes", sizes));
+	CHECK(sizes == std::vector<int>({ 1, 2, 3 }));
+	argparse::ArgSpan<double> point = result.get_list<double>("point");
+	CHECK(point.size == 2 && point[0] == 0.5 && point[1] == -1.5);
+	int level = -1;
+	CHECK(result.get_arg("level", level));
+
+	ok = parse(parser, result, { "tool", "a", "--level", "4", "--sizes" });
+	CHECK(ok.has_value());
+	CHECK(result.get_arg("level", level) && level == 4);
+	CHECK(result.get_arg("sizes", sizes) && sizes.empty());
+
+	ParseOutcome bad = parse(parser, result, { "tool", "a", "--point", "1" });
+	CHECK(bad.error().code == argparse::NARGS_ERROR);
+	CHECK(bad.error().name() == "point");
+
+	bad = parse(parser, result, { "tool", "a", "--sizes", "1", "x" });
+	CHECK(bad.error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(bad.error().argv_index == 4);
+
+	bad = parse(parser, result, { "tool" });
+	CHECK(!bad);
+}
+
+static void test_positionals()
+{
+	const char * list = "argparse_tests_list.txt";
+	write_file(list, "p1\np2\n");
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("files", "Files", ArgType::tString, ArgImportance::iPositional, ArgNargs::nZeroOrMore);
+	parser.set_response_files(argparse::ResponseFileFormat::fNewline);
+	ParseResult result;
+
+	// the trailing positional takes the free tokens after options too
+	CHECK(parse(parser, result, { "tool", "--count", "5", "x", "y" }).has_value());
+	argparse::ArgSpan<std::string_view> files = result.get_list<std::string_view>("files");
+	CHECK(files.size == 2 && files[0] == "x" && files[1] == "y");
+	CHECK(parse(parser, result, { "tool", "x", "--count", "5", "y", "--count", "6", "z" }).has_value());
+	files = result.get_list<std::string_view>("files");
+	CHECK(files.size == 3 && files[0] == "x" && files[1] == "y" && files[2] == "z");
+	CHECK(parse(parser, result, { "tool", "--count", "5", "@argparse_tests_list.txt" }).has_value());
+	files = result.get_list<std::string_view>("files");
+	CHECK(files.size == 2 && files[0] == "p1" && files[1] == "p2");
+
+	// an absent '*' positional is not set
+	std::vector<std::string> values;
+	CHECK(parse(parser, result, { "tool", "--count", "5" }).has_value());
+	CHECK(!result.get_arg("files", values) && values.empty());
+
+	ArgumentParser single("Test", "tool", "");
+	single.add_argument("file", "File", ArgType::tString, ArgImportance::iPositional, ArgNargs::nOptional);
+	single.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	std::string_view file;
+	CHECK(parse(single, result, { "tool" }).has_value());
+	CHECK(!result.get_arg("file", file) && file.empty());
+	CHECK(parse(single, result, { "tool", "--count", "1", "a" }).has_value());
+	CHECK(result.get_arg("file", file) && file == "a");
+
+	// input nothing takes is an error, not dropped
+	ParseOutcome bad = parse(single, result, { "tool", "a", "b" });
+	CHECK(bad.error().code == argparse::UNKNOWN_ARGUMENT_ERROR);
+	CHECK(bad.error().argv_index == 2);
+	CHECK(bad.error().token == "b");
+	CHECK(parse(single, result, { "tool", "a", "b", "--help" }).has_value());
+
+	ArgumentParser some("Test", "tool", "");
+	some.add_argument("files", "Files", ArgType::tString, ArgImportance::iPositional, ArgNargs::nOneOrMore);
+	some.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	CHECK(parse(some, result, { "tool", "--count", "1" }).error().code == argparse::NARGS_ERROR);
+	CHECK(parse(some, result, { "tool", "--count", "1", "a" }).has_value());
+	std::remove(list);
+}
+
+static void test_sources()
+{
+	const char * config = "argparse_tests.ini";
+	std::string long_section(300, 's');
+	write_file(config,
+		"# comment\n"
+		"count = 5\n"
+		"name = 'from config'\n"
+		"sizes = 1, 2 3\n"
+		"[" + long_section + "]\n"
+		"key = 7\n");
+	set_env("ARGPARSE_TESTS_COUNT", "6");
+	set_env("ARGPARSE_TESTS_QUIET", "yes");
+	set_env("ARGPARSE_TESTS_LEVEL", "9");
+
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("name", "Name", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("quiet", "Quiet", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.add_argument("sizes", "Sizes", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nZeroOrMore);
+	parser.add_argument("deep", "Deep", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("level", "Level", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nOptional);
+	parser.set_config_file(config);
+	parser.set_config_key("deep", long_section + ".key");
+	parser.set_env("count", "ARGPARSE_TESTS_COUNT");
+	parser.set_env("quiet", "ARGPARSE_TESTS_QUIET");
+	parser.set_env("level", "ARGPARSE_TESTS_LEVEL");
+	ParseResult result;
+
+	// default < config file < environment < argv
+	CHECK(parse(parser, result, { "tool" }).has_value());
+	int count = 0;
+	std::string_view name;
+	bool quiet = false;
+	std::vector<int> sizes;
+	int deep = 0;
+	CHECK(result.get_arg("count", count) && count == 6);
+	CHECK(result.get_arg("name", name) && name == "from config");
+	CHECK(result.get_arg("quiet", quiet) && quiet);
+	CHECK(result.get_arg("sizes", sizes) && sizes == std::vector<int>({ 1, 2, 3 }));
+	CHECK(result.get_arg("deep", deep) && deep == 7);
+
+	CHECK(parse(parser, result, { "tool", "--count", "8", "--name", "argv" }).has_value());
+	CHECK(result.get_arg("count", count) && count == 8);
+	CHECK(result.get_arg("name", name) && name == "argv");
+
+	// a bare nargs '?' option at the end of argv wins over its variable
+	CHECK(parse(parser, result, { "tool", "--level" }).has_value());
+	int level = -1;
+	CHECK(result.get_arg("level", level) && level == 0);
+
+	set_env("ARGPARSE_TESTS_COUNT", "six");
+	ParseOutcome bad = parse(parser, result, { "tool" });
+	CHECK(bad.error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(bad.error().argv_index == -1);
+	CHECK(bad.error().token == "six");
+
+	set_env("ARGPARSE_TESTS_COUNT", nullptr);
+	set_env("ARGPARSE_TESTS_QUIET", nullptr);
+	set_env("ARGPARSE_TESTS_LEVEL", nullptr);
+	CHECK(parse(parser, result, { "tool" }).has_value());
+	CHECK(result.get_arg("count", count) && count == 5);
+	CHECK(!result.get_arg("quiet", quiet));
+
+	ArgumentParser missing("Test", "tool", "");
+	missing.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	missing.set_config_file("argparse_tests_missing.ini", true);
+	CHECK(parse(missing, result, { "tool" }).error().code == argparse::CONFIG_FILE_ERROR);
+	std::remove(config);
+}
+
+static void test_rules()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("input", "Input", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("json", "JSON", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.add_argument("xml", "XML", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.add_argument("user", "User", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("password", "Password", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("anonymous", "Anonymous", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.set_required("input");
+	parser.add_exclusive_group({ "json", "xml" });
+	parser.add_requires("password", "user");
+	parser.add_conflicts("anonymous", "user");
+	ParseResult result;
+
+	CHECK(parse(parser, result, { "tool", "--input", "a", "--json", "--user", "u", "--password", "p" }).has_value());
+
+	ParseOutcome bad = parse(parser, result, { "tool" });
+	CHECK(bad.error().code == argparse::REQUIRED_ERROR);
+	CHECK(bad.error().name() == "input");
+
+	bad = parse(parser, result, { "tool", "--input", "a", "--json", "--xml" });
+	CHECK(bad.error().code == argparse::EXCLUSIVE_ERROR);
+
+	bad = parse(parser, result, { "tool", "--input", "a", "--password", "p" });
+	CHECK(bad.error().code == argparse::REQUIRES_ERROR);
+	CHECK(bad.error().name() == "password");
+	CHECK(bad.error().other && bad.error().other->arg_name == "user");
+
+	bad = parse(parser, result, { "tool", "--input", "a", "--anonymous", "--user", "u" });
+	CHECK(bad.error().code == argparse::CONFLICT_ERROR);
+
+	// --help skips the rules
+	CHECK(parse(parser, result, { "tool", "--help" }).has_value());
+	CHECK(result.is_help_requested());
+
+	ArgumentParser group("Test", "tool", "");
+	group.add_argument("fast", "Fast", ArgType::tStoreTrue, ArgImportance::iOptional);
+	group.add_argument("safe", "Safe", ArgType::tStoreTrue, ArgImportance::iOptional);
+	group.add_exclusive_group({ "fast", "safe" }, true);
+	CHECK(parse(group, result, { "tool" }).error().code == argparse::REQUIRED_ERROR);
+	CHECK(parse(group, result, { "tool", "--safe" }).has_value());
+}
+
+static void test_short_options()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("verbose", "Verbosity", ArgType::tCount, ArgImportance::iOptional);
+	parser.add_argument("x", "X", ArgType::tStoreTrue, ArgImportance::iOptional);
+	parser.add_argument("output", "Output", ArgType::tString, ArgImportance::iOptional);
+	parser.set_short("verbose", 'v');
+	parser.set_short("output", 'o');
+	ParseResult result;
+
+	CHECK(parse(parser, result, { "tool", "-vvv", "-vx", "-ofile" }).has_value());
+	int verbose = 0;
+	bool x = false;
+	std::string_view output;
+	CHECK(result.get_arg("verbose", verbose) && verbose == 4);
+	CHECK(result.get_arg("x", x) && x);
+	CHECK(result.get_arg("output", output) && output == "file");
+
+	CHECK(parse(parser, result, { "tool", "-vxo", "out" }).has_value());
+	CHECK(result.get_arg("verbose", verbose) && verbose == 1);
+	CHECK(result.get_arg("output", output) && output == "out");
+
+	// the full name with one dash keeps meaning the option
+	CHECK(parse(parser, result, { "tool", "-output", "long", "--verbose" }).has_value());
+	CHECK(result.get_arg("output", output) && output == "long");
+	CHECK(result.get_arg("verbose", verbose) && verbose == 1);
+
+	CHECK(parse(parser, result, { "tool" }).has_value());
+	CHECK(!result.get_arg("verbose", verbose) && verbose == 0);
+
+	ParseOutcome bad = parse(parser, result, { "tool", "-vq" });
+	CHECK(bad.error().code == argparse::SHORT_OPTION_ERROR);
+	CHECK(bad.error().argv_index == 1);
+
+	bool thrown = false;
+	try {
+		parser.set_short("x", 'v');
+	}
+	catch (argparse::Error & err) {
+		thrown = err.code == argparse::DUPLICATE_ARGUMENT_ERROR;
+	}
+	CHECK(thrown);
+}
+
+enum class Mode { fast = 1, safe = 2, slow = 3 };
+
+static void test_choices()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_choices<Mode>("mode", "Mode", { { "fast", Mode::fast }, { "safe", Mode::safe }, { "slow", Mode::slow } });
+	parser.add_choices("level", "Level", { { "Low", 1 }, { "High", 2 } }, ArgImportance::iOptional, true);
+	ParseResult result;
+
+	CHECK(parse(parser, result, { "tool", "--mode", "safe", "--level", "HIGH" }).has_value());
+	Mode mode = Mode::fast;
+	int level = 0;
+	std::string_view spelling;
+	CHECK(result.get_arg("mode", mode) && mode == Mode::safe);
+	CHECK(result.get_arg("level", level) && level == 2);
+	CHECK(result.get_arg("level", spelling) && spelling == "HIGH");
+
+	ParseOutcome bad = parse(parser, result, { "tool", "--mode", "fastest" });
+	CHECK(bad.error().code == argparse::CHOICE_ERROR);
+	CHECK(bad.error().argv_index == 2);
+	CHECK(bad.error().message().find("fast") != std::string::npos);
+	CHECK(parse(parser, result, { "tool", "--mode", "Fast" }).error().code == argparse::CHOICE_ERROR);
+
+	// a parser on a fixed buffer keeps its choice tables there
+	static unsigned char buffer[1 << 14];
+	ArgumentParser fixed(buffer, sizeof(buffer));
+	fixed.add_choices("fmt", "Format", { { "json", 1 }, { "xml", 2 }, { "yaml", 3 }, { "toml", 4 }, { "ini", 5 } });
+	for (int i = 0; i < 5; ++i) {
+		static const std::string_view formats[] = { "json", "xml", "yaml", "toml", "ini" };
+		CHECK(parse(fixed, result, { "tool", "--fmt", formats[i] }).has_value());
+		CHECK(result.get_arg("fmt", level) && level == i + 1);
+	}
+}
+
+static void test_help_cache()
+{
+	ArgumentParser parser("First", "tool", "");
+	parser.add_argument("input", "Input file", ArgType::tString, ArgImportance::iPositional);
+	parser.set_help_width(80);
+	std::string_view help = parser.help_text();
+	CHECK(help.find("First") != std::string_view::npos);
+	CHECK(parser.help_text().data() == help.data());
+	CHECK(help.substr(0, parser.usage_text().size()) == parser.usage_text());
+	CHECK(parser.usage_text().substr(0, 11) == "usage: tool");
+
+	parser.add_argument("count", "Number of runs before the tool gives up and reports what failed", ArgType::tInt, ArgImportance::iOptional);
+	CHECK(parser.help_text().find("Number of runs") != std::string_view::npos);
+
+	parser.set_description("Second");
+	help = parser.help_text();
+	CHECK(help.find("Second") != std::string_view::npos);
+	CHECK(help.find("First") == std::string_view::npos);
+
+	// argv[0] names the usage, also when the parse fails
+	char arg0[] = "/usr/bin/renamed";
+	char arg1[] = "--count";
+	char arg2[] = "many";
+	char * argv[] = { arg0, arg1, arg2 };
+	bool thrown = false;
+	try {
+		parser.parse_args(3, argv);
+	}
+	catch (argparse::Error &) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(parser.usage_text().substr(0, 14) == "usage: renamed");
+
+	std::string text(parser.help_text());
+	parser.set_help_width(40);
+	CHECK(parser.help_text() != text);
+	CHECK(parser.ret_help().str() == std::string(parser.help_text()));
+
+	// a parser on a fixed buffer lays its help out in the buffer
+	static unsigned char buffer[1 << 14];
+	ArgumentParser fixed("Fixed", "tool", "", buffer, sizeof(buffer));
+	fixed.add_argument("inputs", "Input files", ArgType::tString, ArgImportance::iPositional, ArgNargs::nOneOrMore);
+	fixed.add_argument("point", "Point", ArgType::tDouble, ArgImportance::iOptional, ArgNargs::nExactly, 2);
+	fixed.set_help_width(60);
+	std::uint64_t before = heap_allocations;
+	help = fixed.help_text();
+	CHECK(heap_allocations == before);
+	CHECK(help.find("inputs [inputs ...]") != std::string_view::npos);
+	CHECK(help.find("-point POINT POINT") != std::string_view::npos);
+}
+
+static void test_snapshot()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("rate", "Rate", ArgType::tDouble, ArgImportance::iOptional);
+	parser.add_argument("sizes", "Sizes", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nOneOrMore);
+	parser.add_argument("quiet", "Quiet", ArgType::tStoreTrue, ArgImportance::iOptional);
+	ParseResult result;
+	CHECK(parse(parser, result, { "tool", "in.txt", "--count", "3", "--rate", "0.25", "--sizes", "4", "5", "--quiet" }).has_value());
+	std::string blob = parser.save_snapshot(result);
+
+	ParseResult loaded;
+	CHECK(!parser.load_snapshot(blob, loaded));
+	std::string_view input;
+	int count = 0;
+	double rate = 0;
+	bool quiet = false;
+	CHECK(loaded.get_arg("input", input) && input == "in.txt");
+	CHECK(loaded.get_arg("count", count) && count == 3);
+	CHECK(loaded.get_arg("rate", rate) && rate == 0.25);
+	CHECK(loaded.get_arg("quiet", quiet) && quiet);
+	argparse::ArgSpan<int> sizes = loaded.get_list<int>("sizes");
+	CHECK(sizes.size == 2 && sizes[0] == 4 && sizes[1] == 5);
+	CHECK(loaded.get_exec_name() == "tool");
+
+	const char * path = "argparse_tests.snap";
+	write_file(path, blob);
+	ParseResult from_file;
+	CHECK(!parser.load_snapshot_file(path, from_file));
+	CHECK(from_file.get_arg("count", count) && count == 3);
+	std::remove(path);
+
+	// another schema, a truncated blob or garbage are refused
+	ArgumentParser other("Test", "tool", "");
+	other.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+	other.add_argument("count", "Count", ArgType::tInt64, ArgImportance::iOptional);
+	CHECK(other.load_snapshot(blob, loaded).code == argparse::SNAPSHOT_ERROR);
+	CHECK(parser.load_snapshot(std::string_view(blob).substr(0, blob.size() / 2), loaded).code == argparse::SNAPSHOT_ERROR);
+	CHECK(parser.load_snapshot("APSN", loaded).code == argparse::SNAPSHOT_ERROR);
+	CHECK(parser.load_snapshot_file("argparse_tests_missing.snap", loaded).code == argparse::SNAPSHOT_ERROR);
+
+	// changing the schema changes the hash
+	parser.add_argument("late", "Late", ArgType::tInt, ArgImportance::iOptional);
+	CHECK(parser.load_snapshot(blob, loaded).code == argparse::SNAPSHOT_ERROR);
+}
+
+static void test_completion()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("number-int", "Int", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("number-float", "Float", ArgType::tFloat, ArgImportance::iOptional);
+	parser.add_argument("output", "Output", ArgType::tString, ArgImportance::iOptional);
+	parser.add_subcommand("commit", "Commit", [](ArgumentParser & sub) {
+		sub.add_argument("message", "Message", ArgType::tString, ArgImportance::iOptional);
+	});
+
+	std::string out;
+	parser.complete({ "--num" }, out);
+	CHECK(out.find("--number-int\n") != std::string::npos);
+	CHECK(out.find("--number-float\n") != std::string::npos);
+	CHECK(out.find("--output") == std::string::npos);
+
+	// the value of an option is not completed
+	out.clear();
+	parser.complete({ "--output", "" }, out);
+	CHECK(out.empty());
+
+	out.clear();
+	parser.complete({ "com" }, out);
+	CHECK(out == "commit\n");
+
+	out.clear();
+	parser.complete({ "commit", "--m" }, out);
+	CHECK(out == "--message\n");
+
+	char arg0[] = "tool";
+	char arg1[] = "--__complete";
+	char arg2[] = "--out";
+	char * argv[] = { arg0, arg1, arg2 };
+	CHECK(parser.parse_check_complete(3, argv));
+	CHECK(!parser.parse_check_complete(1, argv));
+}
+
+static void test_fixed_buffer()
+{
+	// setup and parsing of a parser on a fixed buffer, subcommands included,
+	// with the result on a buffer too: no heap allocation at all
+	static unsigned char buffer[1 << 16];
+	static unsigned char result_buffer[1 << 14];
+	std::pmr::monotonic_buffer_resource result_memory(result_buffer, sizeof(result_buffer), std::pmr::null_memory_resource());
+	const std::vector<std::string_view> group = { "verbose", "quiet" };
+	const std::vector<std::string_view> args = { "tool", "--mode", "safe", "--verbose", "run", "a.txt", "--jobs", "4" };
+	std::uint64_t before = heap_allocations;
+	{
+		ArgumentParser parser("Fixed", "tool", "", buffer, sizeof(buffer));
+		parser.set_env_prefix("TOOL_");
+		parser.add_choices<Mode>("mode", "Mode", { { "fast", Mode::fast }, { "safe", Mode::safe } });
+		parser.add_argument("verbose", "Verbose", ArgType::tStoreTrue, ArgImportance::iOptional);
+		parser.add_argument("quiet", "Quiet", ArgType::tStoreTrue, ArgImportance::iOptional);
+		parser.add_exclusive_group(group);
+		parser.add_subcommand("run", "Run", [](ArgumentParser & sub) {
+			sub.add_argument("jobs", "Jobs", ArgType::tInt, ArgImportance::iOptional);
+			sub.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+		});
+		ParseResult result(&result_memory);
+		for (int i = 0; i < 2; ++i) {
+			CHECK(parser.try_parse(args, result).has_value());
+			Mode mode = Mode::fast;
+			CHECK(result.get_arg("mode", mode) && mode == Mode::safe);
+			CHECK(result.get_subcommand() == "run");
+			int jobs = 0;
+			CHECK(result.get_subcommand_result()->get_arg("jobs", jobs) && jobs == 4);
+		}
+		CHECK(parser.help_text().find("Verbose") != std::string_view::npos);
+		CHECK(parser.get_subcommand("run")->help_text().find("Jobs") != std::string_view::npos);
+	}
+	CHECK(heap_allocations == before);
+
+	// bad choices leave the parser as it was
+	ArgumentParser parser("Test", "tool", "");
+	CHECK(!error_of([&]() { parser.add_choices("level", "Level", { { "low", 1 }, { "low", 2 } }); }).empty());
+	CHECK(!error_of([&]() { parser.add_choices("level", "Level", { { "a,b", 1 } }); }).empty());
+	parser.add_choices("level", "Level", { { "low", 1 }, { "high", 2 } });
+	ParseResult result;
+	int level = 0;
+	CHECK(parse(parser, result, { "tool", "--level", "high" }).has_value());
+	CHECK(result.get_arg("level", level) && level == 2);
+}
+
+// not standard layout: members are reached through their member pointers
+struct BindConfig {
+	virtual ~BindConfig() {}
+	double scale = 0;
+	bool verbose = false;
+	std::string name;
+	std::string_view tag;
+};
+
+struct OtherConfig {
+	int value;
+};
+
+static void test_bindings()
+{
+	ArgumentParser parser("Test", "tool", "");
+	int threads = 0;
+	std::string output;
+	parser.add_argument("threads", "Worker threads", &threads, ArgImportance::iOptional, 4);
+	parser.add_argument("output", "Output", &output);
+	parser.add_argument("scale", "Scale", &BindConfig::scale, ArgImportance::iOptional, 1.5);
+	parser.add_argument("verbose", "Verbose", &BindConfig::verbose);
+	parser.add_argument("name", "Name", &BindConfig::name, ArgImportance::iOptional, std::string("anon"));
+	parser.add_argument("tag", "Tag", &BindConfig::tag);
+	CHECK(!error_of([&]() { parser.add_argument("value", "Value", &OtherConfig::value); }).empty());
+
+	char arg0[] = "tool";
+	char arg1[] = "--output";
+	char arg2[] = "out.txt";
+	char arg3[] = "--verbose";
+	char arg4[] = "--tag";
+	char arg5[] = "t1";
+	char * argv[] = { arg0, arg1, arg2, arg3, arg4, arg5 };
+	ParseResult result;
+	BindConfig config;
+	parser.parse_args(6, argv, result, config);
+	CHECK(threads == 4);
+	CHECK(output == "out.txt");
+	CHECK(config.scale == 1.5);
+	CHECK(config.verbose);
+	CHECK(config.name == "anon");
+	CHECK(config.tag == "t1");
+
+	char arg6[] = "--threads";
+	char arg7[] = "8";
+	char arg8[] = "--scale";
+	char arg9[] = "0.25";
+	char * again[] = { arg0, arg6, arg7, arg8, arg9 };
+	BindConfig second;
+	CHECK(parser.try_parse(5, again, result, second).has_value());
+	CHECK(threads == 8);
+	CHECK(second.scale == 0.25);
+	CHECK(!second.verbose);
+	CHECK(second.tag.empty());
+
+	// a bad value stores nothing; a struct with no bound members is refused
+	char arg10[] = "many";
+	char * bad[] = { arg0, arg6, arg10 };
+	threads = 0;
+	CHECK(parser.try_parse(3, bad, result, second).error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(threads == 0);
+	OtherConfig other;
+	CHECK(!error_of([&]() { parser.parse_args(1, argv, result, other); }).empty());
+}
+
+static void test_parse_batch()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_subcommand("run", "Run", [](ArgumentParser & sub) {
+		sub.add_argument("jobs", "Jobs", ArgType::tInt, ArgImportance::iOptional);
+	});
+	static const std::string_view counts[] = { "0", "1", "2", "3", "4", "5", "6", "7" };
+	std::vector<std::vector<std::string_view>> lines;
+	for (size_t i = 0; i < 200; ++i) {
+		if (i % 10 == 9)
+			lines.push_back({ "tool", "in", "--count", "many" });
+		else
+			lines.push_back({ "tool", "in", "--count", counts[i % 8], "run", "--jobs", counts[i % 8] });
+	}
+	std::vector<ParseResult> results;
+	for (unsigned int workers : { 0u, 1u, 4u, 500u }) {
+		parser.parse_batch(lines, results, workers);
+		CHECK(results.size() == lines.size());
+		for (size_t i = 0; i < lines.size(); ++i) {
+			int count = -1;
+			int jobs = -1;
+			if (i % 10 == 9) {
+				CHECK(results[i].get_error().code == argparse::CONVERT_ARG_ERROR);
+				continue;
+			}
+			CHECK(results[i].get_error().code == argparse::NO_ERROR);
+			CHECK(results[i].get_arg("count", count) && count == static_cast<int>(i % 8));
+			CHECK(results[i].get_subcommand_result()->get_arg("jobs", jobs) && jobs == static_cast<int>(i % 8));
+		}
+	}
+
+	// fewer lines shrink the results
+	lines.resize(3);
+	parser.parse_batch(lines, results, 2);
+	CHECK(results.size() == 3);
+	lines.clear();
+	parser.parse_batch(lines, results, 2);
+	CHECK(results.empty());
+}
+
+// words of line after the executable, "!" + the error code on failure
+static std::vector<std::string> command_line_words(const ArgumentParser & parser, std::string_view line)
+{
+	ParseResult result;
+	ParseOutcome outcome = parser.try_parse_command_line(line, result);
+	if (!outcome)
+		return { "!" + std::to_string(outcome.error().code) };
+	std::vector<std::string> words(1, std::string(result.get_exec_name()));
+	std::vector<std::string_view> rest;
+	result.get_arg("rest", rest);
+	words.insert(words.end(), rest.begin(), rest.end());
+	return words;
+}
+
+static void test_command_line()
+{
+	using namespace std::literals;
+	typedef std::vector<std::string> Words;
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("rest", "Rest", ArgType::tString, ArgImportance::iPositional, ArgNargs::nZeroOrMore);
+
+	CHECK(command_line_words(parser, "tool a  b\tc\n") == Words({ "tool", "a", "b", "c" }));
+	CHECK(command_line_words(parser, "tool 'a b' \"c d\" e\\ f") == Words({ "tool", "a b", "c d", "e f" }));
+	CHECK(command_line_words(parser, "tool 'a\\b' \"\\$x \\\" \\y\" ''") == Words({ "tool", "a\\b", "$x \" \\y", "" }));
+	CHECK(command_line_words(parser, "tool a\\\nb x'y'\"z\"") == Words({ "tool", "ab", "xyz" }));
+	CHECK(command_line_words(parser, "tool 'open") == Words({ "!" + std::to_string(argparse::COMMAND_LINE_ERROR) }));
+	CHECK(command_line_words(parser, "tool \"open\\\"") == Words({ "!" + std::to_string(argparse::COMMAND_LINE_ERROR) }));
+
+	// NUL-separated input is split on NUL only; a trailing NUL ends the last word
+	CHECK(command_line_words(parser, "a\0b c\0"sv) == Words({ "a", "b c" }));
+	CHECK(command_line_words(parser, "tool\0a\0\0b\0"sv) == Words({ "tool", "a", "", "b" }));
+	CHECK(command_line_words(parser, "tool\0a\\ b\0c"sv) == Words({ "tool", "a\\ b", "c" }));
+	CHECK(command_line_words(parser, "tool\0a\0\0"sv) == Words({ "tool", "a", "" }));
+
+	// the words are copied: the line can go before the result
+	ParseResult result;
+	{
+		std::string line = "tool \"kept word\"";
+		CHECK(parser.try_parse_command_line(line, result).has_value());
+	}
+	std::vector<std::string_view> rest;
+	CHECK(result.get_arg("rest", rest) && rest.size() == 1 && rest[0] == "kept word");
+}
+
+static void test_response_files()
+{
+	write_file("argparse_tests_outer.rsp", "--count\r\n7\n\n@argparse_tests_inner.rsp\nlast\n");
+	write_file("argparse_tests_inner.rsp", "in1\nin 2\n");
+	static const char nul[] = "--count\0" "9\0" "a b\0" "c\nd\0";
+	write_file("argparse_tests_nul.rsp", std::string(nul, sizeof(nul) - 1));
+	write_file("argparse_tests_loop.rsp", "x\n@argparse_tests_loop.rsp\n");
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("files", "Files", ArgType::tString, ArgImportance::iPositional, ArgNargs::nZeroOrMore);
+	ParseResult result;
+	int count = 0;
+	std::vector<std::string_view> files;
+
+	// off by default: "@path" is an ordinary argument
+	CHECK(parse(parser, result, { "tool", "@argparse_tests_outer.rsp" }).has_value());
+	CHECK(result.get_arg("files", files) && files.size() == 1 && files[0] == "@argparse_tests_outer.rsp");
+
+	// one argument per line, CRLF and empty lines handled, files nest
+	parser.set_response_files(argparse::ResponseFileFormat::fNewline);
+	CHECK(parse(parser, result, { "tool", "first", "@argparse_tests_outer.rsp" }).has_value());
+	CHECK(result.get_arg("count", count) && count == 7);
+	CHECK(result.get_arg("files", files) && files == std::vector<std::string_view>({ "first", "in1", "in 2", "last" }));
+
+	// NUL-separated, given or detected; a newline is part of an argument there
+	parser.set_response_files(argparse::ResponseFileFormat::fNul);
+	CHECK(parse(parser, result, { "tool", "@argparse_tests_nul.rsp" }).has_value());
+	CHECK(result.get_arg("count", count) && count == 9);
+	CHECK(result.get_arg("files", files) && files == std::vector<std::string_view>({ "a b", "c\nd" }));
+	parser.set_response_files(argparse::ResponseFileFormat::fAuto, '+');
+	CHECK(parse(parser, result, { "tool", "+argparse_tests_nul.rsp", "+argparse_tests_inner.rsp" }).has_value());
+	CHECK(result.get_arg("files", files) && files == std::vector<std::string_view>({ "a b", "c\nd", "in1", "in 2" }));
+
+	// a file including itself stops at the depth limit, a missing one is an error
+	parser.set_response_files(argparse::ResponseFileFormat::fAuto);
+	ParseOutcome loop = parse(parser, result, { "tool", "@argparse_tests_loop.rsp" });
+	CHECK(loop.error().code == argparse::RESPONSE_FILE_DEPTH_ERROR);
+	ParseOutcome missing = parse(parser, result, { "tool", "x", "@argparse_tests_missing.rsp" });
+	CHECK(missing.error().code == argparse::RESPONSE_FILE_ERROR);
+	CHECK(missing.error().argv_index == 2);
+	CHECK(missing.error().token == "argparse_tests_missing.rsp");
+
+	std::remove("argparse_tests_outer.rsp");
+	std::remove("argparse_tests_inner.rsp");
+	std::remove("argparse_tests_nul.rsp");
+	std::remove("argparse_tests_loop.rsp");
+}
+
+static void test_lazy_conversion()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("rate", "Rate", ArgType::tDouble, ArgImportance::iOptional);
+	parser.add_argument("sizes", "Sizes", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nOneOrMore);
+	parser.set_lazy_conversion(true);
+	ParseResult result;
+
+	// bad values parse; each fails when it is read
+	CHECK(parse(parser, result, { "tool", "--count", "3", "--rate", "fast", "--sizes", "1", "x" }).has_value());
+	int count = 0;
+	CHECK(result.get_arg("count", count) && count == 3);
+	CHECK(result.get_arg("count", count) && count == 3);
+	double rate = 0;
+	CHECK(error_of([&]() { result.get_arg("rate", rate); }).find("rate") != std::string::npos);
+	std::vector<int> sizes;
+	CHECK(error_of([&]() { result.get_arg("sizes", sizes); }).find("sizes") != std::string::npos);
+
+	// the first bad argument in registration order, with or without throwing
+	argparse::ParseError error = result.try_validate_all();
+	CHECK(error.code == argparse::CONVERT_ARG_ERROR);
+	CHECK(error.arg && error.arg->arg_name == "rate");
+	CHECK(error.token == "fast");
+	CHECK(error_of([&]() { result.validate_all(); }).find("rate") != std::string::npos);
+
+	CHECK(parse(parser, result, { "tool", "--rate", "0.5", "--sizes", "1", "2" }).has_value());
+	CHECK(result.try_validate_all().code == argparse::NO_ERROR);
+	CHECK(result.get_arg("rate", rate) && rate == 0.5);
+	CHECK(result.get_arg("sizes", sizes) && sizes == std::vector<int>({ 1, 2 }));
+	CHECK(!result.get_arg("count", count));
+
+	// eager mode fails the parse itself
+	parser.set_lazy_conversion(false);
+	ParseOutcome eager = parse(parser, result, { "tool", "--count", "3", "--rate", "fast" });
+	CHECK(eager.error().code == argparse::CONVERT_ARG_ERROR);
+	CHECK(eager.error().argv_index == 4);
+}
+
+static void test_abbreviations()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("number-int", "Int", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("number-float", "Float", ArgType::tFloat, ArgImportance::iOptional);
+	parser.add_argument("out", "Out", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("output", "Output", ArgType::tString, ArgImportance::iOptional);
+	parser.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+	ParseResult result;
+	int number = 0;
+	float real = 0;
+	std::string_view text;
+
+	// off by default: a prefix is not an option
+	CHECK(!parse(parser, result, { "tool", "in", "--number-i", "3" }).has_value());
+
+	parser.set_abbreviations(true);
+	CHECK(parse(parser, result, { "tool", "in", "--number-i", "3", "--number-f=0.5" }).has_value());
+	CHECK(result.get_arg("number-int", number) && number == 3);
+	CHECK(result.get_arg("number-float", real) && real == 0.5f);
+
+	// an exact name wins over the longer names it prefixes
+	CHECK(parse(parser, result, { "tool", "in", "--out", "a", "--outp", "b" }).has_value());
+	CHECK(result.get_arg("out", text) && text == "a");
+	CHECK(result.get_arg("output", text) && text == "b");
+
+	ParseOutcome ambiguous = parse(parser, result, { "tool", "in", "--num", "3" });
+	CHECK(ambiguous.error().code == argparse::AMBIGUOUS_OPTION_ERROR);
+	CHECK(ambiguous.error().argv_index == 2);
+	CHECK(ambiguous.error().message().find("--num") != std::string::npos);
+
+	// positionals are not abbreviated
+	CHECK(!parse(parser, result, { "tool", "in", "--inp", "x" }).has_value());
+}
+
+static void test_stats()
+{
+	ArgumentParser parser("Test", "tool", "");
+	parser.add_argument("input", "Input", ArgType::tString, ArgImportance::iPositional);
+	parser.add_argument("count", "Count", ArgType::tInt, ArgImportance::iOptional);
+	parser.add_argument("sizes", "Sizes", ArgType::tInt, ArgImportance::iOptional, ArgNargs::nOneOrMore);
+	std::string name;
+	parser.add_argument("name", "Name", &name);
+
+	// the result's allocations are counted, and stop once its buffers are grown
+	argparse::ParseStats stats;
+	ParseResult result(&stats);
+	result.set_stats(&stats);
+	CHECK(parse(parser, result, { "tool", "in", "--count", "3", "--sizes", "1", "2", "--name", "abc" }).has_value());
+	std::uint64_t allocations = stats.allocations;
+	CHECK(allocations > 0 && stats.allocated_bytes > 0);
+	CHECK(parse(parser, result, { "tool", "in", "--count", "4", "--sizes", "5", "6", "--name", "def" }).has_value());
+	CHECK(stats.allocations == allocations);
+#ifdef ARGPARSE_STATS
+	// argv[0] is not a token; one lookup per option
+	CHECK(stats.parses == 2);
+	CHECK(stats.tokens == 16);
+	CHECK(stats.lookups == 6);
+	CHECK(stats.bytes_copied == 6);
+#endif
+
+	// log2 buckets: 0 and 1 ns share the first, 1000 ns is in [512, 1024)
+	argparse::ParseStats other;
+	other.add_parse(0);
+	other.add_parse(1);
+	other.add_parse(1000);
+	CHECK(other.parses == 3);
+	CHECK(other.histogram[0] == 2 && other.histogram[9] == 1);
+	other.tokens = 5;
+	std::uint64_t parses = stats.parses;
+	stats.merge(other);
+	CHECK(stats.parses == parses + 3);
+	CHECK(stats.histogram[9] >= 1);
+
+	other.allocations = 7;
+	std::string json = other.to_json();
+	CHECK(json.find("{\"parses\":3,\"phase_ns\":{\"exec_name\":0,") == 0);
+	CHECK(json.find("\"tokens\":5,") != std::string::npos);
+	CHECK(json.find("\"allocations\":7,") != std::string::npos);
+	CHECK(json.find("\"histogram_log2_ns\":[2,0,0,0,0,0,0,0,0,1]}") != std::string::npos);
+	std::string text = other.to_key_value();
+	CHECK(text.find("parses=3\n") == 0);
+	CHECK(text.find("phase_ns.bind=0\n") != std::string::npos);
+	CHECK(text.find("histogram_log2_ns.0=2\nhistogram_log2_ns.9=1\n") != std::string::npos);
+
+	other.reset();
+	CHECK(other.parses == 0 && other.tokens == 0 && other.allocations == 0 && other.histogram[0] == 0);
+}
+
+struct TestCase {
+	const char * name;
+	void (*run)();
+};
+
+static const TestCase tests[] = {
+	{ "static_schema", test_static_schema },
+	{ "try_parse", test_try_parse },
+	{ "nargs", test_nargs },
+	{ "positionals", test_positionals },
+	{ "sources", test_sources },
+	{ "rules", test_rules },
+	{ "short_options", test_short_options },
+	{ "choices", test_choices },
+	{ "help_cache", test_help_cache },
+	{ "snapshot", test_snapshot },
+	{ "completion", test_completion },
+	{ "fixed_buffer", test_fixed_buffer },
+	{ "bindings", test_bindings },
+	{ "parse_batch", test_parse_batch },
+	{ "command_line", test_command_line },
+	{ "response_files", test_response_files },
+	{ "lazy_conversion", test_lazy_conversion },
+	{ "abbreviations", test_abbreviations },
+	{ "stats", test_stats },
+};
+
+int main(int argc, char * argv[])
+{
+	bool found = false;
+	for (const TestCase & test : tests) {
+		if (argc > 1 && std::strcmp(argv[1], test.name) != 0)
+			continue;
+		found = true;
+		int before = failures;
+		try {
+			test.run();
+		}
+		catch (std::exception & err) {
+			++failures;
+			std::cerr << test.name << ": unexpected exception: " << err.what() << std::endl;
+		}
+		std::cout << (failures == before ? "[ok]   " : "[FAIL] ") << test.name << std::endl;
+	}
+	if (!found) {
+		std::cerr << "unknown test " << argv[1] << std::endl;
+		return 2;
+	}
+	return failures ? 1 : 0;
+}